@@ -3,15 +3,17 @@
 #ifndef CODEREVERSE_AST_HPP
 #define CODEREVERSE_AST_HPP
 
-#include "Common.hpp"
+#include "Lexer.hpp"     // for TokenID
 #include <memory>   // for std::shared_ptr, std::make_shared
+#include <atomic>   // for std::atomic
+#include <new>      // for placement new
+#include <ostream>  // for std::basic_ostream
 
 /////////////////////////////////////////////////////////////////////////
 
 namespace CodeReverse
 {
-    #define s_p  std::shared_ptr
-    #define m_s  std::make_shared
+    #define s_p  AST_ptr
     typedef std::map<string_type, string_type> attributes_type;
 
     /////////////////////////////////////////////////////////////////////////
@@ -22,6 +24,7 @@ namespace CodeReverse
 
         struct AST_translation_unit;
         struct AST_external_declaration;
+        struct AST_skipped_declaration;
         struct AST_function_definition;
         struct AST_declaration;
         struct AST_declaration_specifiers;
@@ -97,13 +100,83 @@ namespace CodeReverse
         struct AST_iteration_statement;
         struct AST_jump_statement;
         struct AST_asm_statement;
+        struct AST_expr;
+
+    /////////////////////////////////////////////////////////////////////////
+    // AST_ptr --- non-owning pointer to a node
+    //
+    // The nodes belong to the AST_arena that made them, so a pointer is
+    // only an address; it is null by default.
+
+    template <typename T>
+    class AST_ptr
+    {
+    public:
+        AST_ptr() : m_ptr(NULL)
+        {
+        }
+        AST_ptr(std::nullptr_t) : m_ptr(NULL)
+        {
+        }
+        explicit AST_ptr(T *ptr) : m_ptr(ptr)
+        {
+        }
+        template <typename U>
+        AST_ptr(const AST_ptr<U>& ptr) : m_ptr(ptr.get())
+        {
+        }
+
+        T *get() const
+        {
+            return m_ptr;
+        }
+        T *operator->() const
+        {
+            return m_ptr;
+        }
+        T& operator*() const
+        {
+            return *m_ptr;
+        }
+        explicit operator bool() const
+        {
+            return m_ptr != NULL;
+        }
+        void reset()
+        {
+            m_ptr = NULL;
+        }
+
+    protected:
+        T *m_ptr;
+    };
+
+    template <typename T, typename U>
+    inline AST_ptr<T> static_pointer_cast(const AST_ptr<U>& ptr)
+    {
+        return AST_ptr<T>(static_cast<T *>(ptr.get()));
+    }
+
+    template <class CharT, class Traits, typename T>
+    inline std::basic_ostream<CharT,Traits>&
+    operator<<(std::basic_ostream<CharT,Traits>& os, const AST_ptr<T>& ptr)
+    {
+        os << static_cast<const void *>(ptr.get());
+        return os;
+    }
 
     /////////////////////////////////////////////////////////////////////////
     // AST_base --- base class of all A.S.T.
 
     struct AST_base
     {
-        AST_base()
+        // the tokens of the node as [m_first, m_last) in the token stream.
+        // Both are zero if the parser did not set them. Lexer::begin_pos
+        // and Lexer::end_pos give the positions.
+        unsigned int m_first;
+        unsigned int m_last;
+
+        AST_base() : m_first(0), m_last(0)
         {
             increment();
         }
@@ -111,9 +184,9 @@ namespace CodeReverse
         {
             decrement();
         }
-        static int& alive_count()
+        static std::atomic<int>& alive_count()
         {
-            static int s_count = 0;
+            static std::atomic<int> s_count(0);
             return s_count;
         }
         void increment()
@@ -129,6 +202,54 @@ namespace CodeReverse
         AST_base& operator=(const AST_base&);
     };
 
+    /////////////////////////////////////////////////////////////////////////
+    // AST_arena --- the storage of the nodes
+    //
+    // A bump allocator over blocks. The nodes are destroyed together when
+    // the arena is cleared, or back to a mark by rollback(), which gives
+    // the space of a failed attempt back. The blocks are kept for reuse
+    // until clear(). A node must not point to a node made after it unless
+    // both go back together.
+
+    class AST_arena
+    {
+    public:
+        struct Mark
+        {
+            size_t m_block;
+            size_t m_used;
+            size_t m_nodes;
+        };
+
+        AST_arena();
+        ~AST_arena();
+
+        template <typename T_AST>
+        AST_ptr<T_AST> make();
+
+        Mark mark() const;
+        void rollback(const Mark& mark);
+        void adopt(AST_arena& arena);
+        void clear();
+
+        size_t size() const;    // the number of nodes
+        size_t bytes() const;   // the size of the blocks
+
+    protected:
+        enum { BLOCK_SIZE = 64 * 1024 };
+        std::vector<char *>     m_blocks;
+        size_t                  m_block;    // the block in use
+        size_t                  m_used;     // the bytes used in it
+        std::vector<AST_base *> m_nodes;    // in the order made
+        std::vector<char *>     m_adopted;  // the blocks of other arenas
+
+        void *allocate(size_t size, size_t align);
+
+    private:
+        AST_arena(const AST_arena&);
+        AST_arena& operator=(const AST_arena&);
+    };
+
     /////////////////////////////////////////////////////////////////////////
     // AST_vector --- vector of A.S.T.
 
@@ -171,6 +292,18 @@ namespace CodeReverse
         }
     };
 
+    /////////////////////////////////////////////////////////////////////////
+    // AST_body_parser --- parses a function body on demand
+
+    struct AST_body_parser
+    {
+        virtual ~AST_body_parser()
+        {
+        }
+        virtual s_p<AST_compound_statement>
+        parse_body(size_t begin, size_t end, size_t names) = 0;
+    };
+
     /////////////////////////////////////////////////////////////////////////
 
     // translation-unit = {external-declaration};
@@ -184,6 +317,19 @@ namespace CodeReverse
     {
         s_p<AST_declaration> m_decl;
         s_p<AST_function_definition> m_func_def;
+        s_p<AST_skipped_declaration> m_skipped;     // in recovery mode
+    };
+
+    // NOTE: Not in the grammar. It stands for the tokens that the recovery
+    //       mode skipped over after an error.
+    struct AST_skipped_declaration : AST_base
+    {
+        size_t m_begin;     // the token index of the first one skipped
+        size_t m_end;       // the token index next to the last one skipped
+
+        AST_skipped_declaration() : m_begin(0), m_end(0)
+        {
+        }
     };
 
     // function-definition = declaration-specifiers, {function-attribute}, declarator, [declaration-list], compound-statement;
@@ -192,8 +338,18 @@ namespace CodeReverse
         s_p<AST_declaration_specifiers> m_decl_specs;
         s_p<AST_declarator> m_declor;
         s_p<AST_declaration_list> m_decl_list;
-        s_p<AST_compound_statement> m_comp_stmt;
+        s_p<AST_compound_statement> m_comp_stmt;   // null if skimmed or lazy
         attributes_type m_attrs;
+        size_t m_body_begin;    // the token index of '{'
+        size_t m_body_end;      // the token index next to '}'
+        std::shared_ptr<AST_body_parser> m_body_parser;     // non-null if lazy
+        size_t m_names;         // the snapshot of the names for the body
+
+        AST_function_definition() : m_body_begin(0), m_body_end(0), m_names(0)
+        {
+        }
+
+        s_p<AST_compound_statement> comp_stmt();
     };
 
     // declaration = declaration-specifiers, [init-declarator-list], {function-attribute}, ';'
@@ -429,6 +585,7 @@ namespace CodeReverse
     struct AST_constant_expression : AST_base
     {
         s_p<AST_conditional_expression> m_cond_expr;
+        s_p<AST_expr> m_compact;    // instead of the above in compact mode
     };
 
     // atomic-type-specifier = '_Atomic', '(', type-name, ')';
@@ -579,6 +736,7 @@ namespace CodeReverse
     // expression = assignment-expression, {',', assignment-expression};
     struct AST_expression : AST_vector<AST_assignment_expression>
     {
+        s_p<AST_expr> m_compact;    // instead of the items in compact mode
     };
 
     // assignment-expression = conditional-expression
@@ -598,8 +756,9 @@ namespace CodeReverse
     {
         s_p<AST_conditional_expression> m_cond_expr;
         s_p<AST_unary_expression> m_unary_expr;
-        string_type m_assign_op;
+        TokenID m_assign_op;
         s_p<AST_assignment_expression> m_child;     // right associative
+        s_p<AST_expr> m_compact;    // instead of the above in compact mode
     };
 
     // conditional-expression = logical-or-expression, ['?', expression, ':', conditional-expression];
@@ -644,7 +803,7 @@ namespace CodeReverse
     struct AST_equality_expression : AST_base
     {
         s_p<AST_equality_expression> m_child;   // left associative
-        string_type m_op;   // '', '==' or '!='
+        TokenID m_op;   // TID_NONE, '==' or '!='
         s_p<AST_relational_expression> m_rel_expr;
     };
 
@@ -652,7 +811,7 @@ namespace CodeReverse
     struct AST_relational_expression : AST_base
     {
         s_p<AST_relational_expression> m_child; // left associative
-        string_type m_op;   // '', '<', '>', '<=' or '>='
+        TokenID m_op;   // TID_NONE, '<', '>', '<=' or '>='
         s_p<AST_shift_expression> m_shift_expr;
     };
 
@@ -660,7 +819,7 @@ namespace CodeReverse
     struct AST_shift_expression : AST_base
     {
         s_p<AST_shift_expression> m_child;      // left associative
-        string_type m_op;   // '', '<<' or '>>'
+        TokenID m_op;   // TID_NONE, '<<' or '>>'
         s_p<AST_additive_expression> m_add_expr;
     };
 
@@ -668,7 +827,7 @@ namespace CodeReverse
     struct AST_additive_expression : AST_base
     {
         s_p<AST_additive_expression> m_child;   // left associative
-        string_type m_op;   // '', '+' or '-'
+        TokenID m_op;   // TID_NONE, '+' or '-'
         s_p<AST_multiplicative_expression> m_mul_expr;
     };
 
@@ -676,7 +835,7 @@ namespace CodeReverse
     struct AST_multiplicative_expression : AST_base
     {
         s_p<AST_multiplicative_expression> m_child;     // left associative
-        string_type m_op;   // '', '*', '/' or '%'
+        TokenID m_op;   // TID_NONE, '*', '/' or '%'
         s_p<AST_cast_expression> m_cast_expr;
     };
 
@@ -703,7 +862,7 @@ namespace CodeReverse
     //                | '!';
     struct AST_unary_expression : AST_base
     {
-        string_type m_op;   // '', '++', '--', '&', '*', '+', '-', '~', '!', 'sizeof' or '_Alignof'
+        TokenID m_op;   // TID_NONE, '++', '--', '&', '*', '+', '-', '~', '!', 'sizeof' or '_Alignof'
         s_p<AST_postfix_expression> m_postfix_expr;
         s_p<AST_unary_expression> m_child;
         s_p<AST_cast_expression> m_cast_expr;
@@ -719,7 +878,7 @@ namespace CodeReverse
     struct AST_postfix_expression : AST_base
     {
         s_p<AST_primary_expression> m_prim_expr;
-        string_type m_str;   // '', '[]', '()', 'compound', '.', '->', '++' or '--'
+        TokenID m_op;   // TID_NONE, '[', '.', '->', '++' or '--'
         s_p<AST_postfix_expression> m_child;    // left associative
         s_p<AST_expression> m_expr;
         s_p<AST_argument_expression_list> m_arg_expr_list;
@@ -888,9 +1047,149 @@ namespace CodeReverse
         // not supported yet
     };
 
+    // NOTE: Not in the grammar. An expression in the compact form that the
+    //       compact mode of the parser makes. The levels of the grammar
+    //       that only hold their child are left out, so that the chain of
+    //       sixteen nodes above an identifier becomes one. ExprExpander
+    //       gives back the full form.
+    struct AST_expr : AST_base
+    {
+        enum {
+            E_IDENT,        // m_ident
+            E_CONST,        // m_const
+            E_STR,          // m_str, m_fix
+            E_PAREN,        // '(', m_lhs, ')'
+            E_GENERIC,      // m_gen_sel
+            E_COMPOUND,     // '(', type-name, ')', '{', initializer-list, '}'
+            E_INDEX,        // m_lhs, '[', m_rhs, ']'
+            E_CALL,         // m_lhs, '(', m_args, ')'
+            E_MEMBER,       // m_lhs, m_op, m_ident; '.' or '->'
+            E_POSTFIX,      // m_lhs, m_op; '++' or '--'
+            E_UNARY,        // m_op, m_lhs; '++', '--', '&', '*', '+', '-', '~', '!' or 'sizeof'
+            E_UNARY_TYPE,   // m_op, '(', m_type_name, ')'; 'sizeof' or '_Alignof'
+            E_CAST,         // '(', m_type_name, ')', m_lhs
+            E_BINARY,       // m_lhs, m_op, m_rhs; ',', '||', '&&', ... or '%'
+            E_COND,         // m_lhs, '?', m_rhs, ':', m_third
+            E_ASSIGN        // m_lhs, m_op, m_rhs; an assignment-operator
+        } m_type;
+        TokenID m_op;
+        s_p<AST_expr> m_lhs, m_rhs, m_third;
+        std::vector<s_p<AST_expr> > m_args;
+        s_p<AST_identifier> m_ident;
+        s_p<AST_constant> m_const;
+        s_p<AST_type_name> m_type_name;
+        s_p<AST_generic_selection> m_gen_sel;
+        string_type m_str;
+        string_type m_fix;
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // AST_arena inlines
+
+    inline AST_arena::AST_arena() : m_block(0), m_used(0)
+    {
+    }
+    inline AST_arena::~AST_arena()
+    {
+        clear();
+        for (auto block : m_blocks)
+        {
+            delete[] block;
+        }
+    }
+    inline void *AST_arena::allocate(size_t size, size_t align)
+    {
+        assert(size <= BLOCK_SIZE && align <= 16);
+        size_t used = (m_used + align - 1) & ~(align - 1);
+        if (m_blocks.empty() || used + size > BLOCK_SIZE)
+        {
+            if (!m_blocks.empty())
+                ++m_block;
+            if (m_block == m_blocks.size())
+                m_blocks.push_back(new char[BLOCK_SIZE]);
+            used = 0;
+        }
+        m_used = used + size;
+        return m_blocks[m_block] + used;
+    }
+    template <typename T_AST>
+    inline AST_ptr<T_AST> AST_arena::make()
+    {
+        T_AST *node = new(allocate(sizeof(T_AST), alignof(T_AST))) T_AST();
+        m_nodes.push_back(node);
+        return AST_ptr<T_AST>(node);
+    }
+    inline AST_arena::Mark AST_arena::mark() const
+    {
+        Mark mark = { m_block, m_used, m_nodes.size() };
+        return mark;
+    }
+    // destroys the nodes made after the mark, the last first
+    inline void AST_arena::rollback(const Mark& mark)
+    {
+        assert(mark.m_nodes <= m_nodes.size());
+        while (m_nodes.size() > mark.m_nodes)
+        {
+            m_nodes.back()->~AST_base();
+            m_nodes.pop_back();
+        }
+#ifndef NDEBUG
+        // catch the pointers left to them
+        for (size_t k = mark.m_block; k <= m_block && k < m_blocks.size(); ++k)
+        {
+            size_t begin = (k == mark.m_block ? mark.m_used : 0);
+            size_t end = (k == m_block ? m_used : size_t(BLOCK_SIZE));
+            if (begin < end)
+                memset(m_blocks[k] + begin, 0xDD, end - begin);
+        }
+#endif
+        m_block = mark.m_block;
+        m_used = mark.m_used;
+    }
+    // takes over the nodes of the other arena, which gets empty
+    inline void AST_arena::adopt(AST_arena& arena)
+    {
+        m_nodes.insert(m_nodes.end(), arena.m_nodes.begin(), arena.m_nodes.end());
+        m_adopted.insert(m_adopted.end(), arena.m_blocks.begin(), arena.m_blocks.end());
+        m_adopted.insert(m_adopted.end(), arena.m_adopted.begin(), arena.m_adopted.end());
+        arena.m_nodes.clear();
+        arena.m_blocks.clear();
+        arena.m_adopted.clear();
+        arena.m_block = arena.m_used = 0;
+    }
+    inline void AST_arena::clear()
+    {
+        Mark mark = { 0, 0, 0 };
+        rollback(mark);
+        for (auto block : m_adopted)
+        {
+            delete[] block;
+        }
+        m_adopted.clear();
+    }
+    inline size_t AST_arena::size() const
+    {
+        return m_nodes.size();
+    }
+    inline size_t AST_arena::bytes() const
+    {
+        return (m_blocks.size() + m_adopted.size()) * BLOCK_SIZE;
+    }
+
     /////////////////////////////////////////////////////////////////////////
     // inlines
 
+    // parses a lazy body on first use
+    inline s_p<AST_compound_statement> AST_function_definition::comp_stmt()
+    {
+        if (!m_comp_stmt && m_body_parser)
+        {
+            m_comp_stmt = m_body_parser->parse_body(m_body_begin, m_body_end, m_names);
+            m_body_parser.reset();
+        }
+        return m_comp_stmt;
+    }
+
     inline bool AST_declaration_specifier::is_typedef_name() const
     {
         return m_type == DS_TYPE_SPEC && m_type_spec &&
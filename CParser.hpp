@@ -5,7 +5,15 @@
 
 #include "Lexer.hpp"
 #include "AST.hpp"
+#include "CompactExpr.hpp"
 #include <set>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
 
 #ifndef NDEBUG
     #include <iostream>
@@ -19,24 +27,180 @@
     #endif
 #endif
 
-#if 1
-    #define CR_SHOW_STATUS()        /*empty*/
-    #define CR_RETURN_AST(value)    return (value)
+// CR_SHOW_STATUS() remembers the first token of the rule and the arena,
+// so that CR_RETURN_AST() can give the node its span, or give back the
+// nodes made by the rule if it returns nullptr.
+#ifdef CR_PROFILE_PARSER
+    #define CR_SHOW_STATUS() \
+        const size_t cr_first = m_index; (void)cr_first; \
+        const Mark cr_mark = mark(); (void)cr_mark; \
+        ParserProfile::Call cr_call(m_profile, __func__, m_index)
+    #define CR_RETURN_AST(value) \
+        return cr_call.result(span(value, cr_first, cr_mark))
 #else
     #define CR_SHOW_STATUS() \
-        DEBUG_ONLY(std::cout << __func__ << ": " << str() << std::endl)
-
-    #define CR_RETURN_AST(value) do { \
-        DEBUG_ONLY(std::cout << __func__ << ": (" << __LINE__ << "): " << \
-                   str() << ": return " << s_p<AST_base>(value) << std::endl); \
-        return value; \
-    } while (0)
+        const size_t cr_first = m_index; (void)cr_first; \
+        const Mark cr_mark = mark(); (void)cr_mark
+    #define CR_RETURN_AST(value)    return span(value, cr_first, cr_mark)
 #endif
 
 /////////////////////////////////////////////////////////////////////////
 
 namespace CodeReverse
 {
+    /////////////////////////////////////////////////////////////////////////
+    // MemoStats --- counters of the packrat memo of CParser
+
+    struct MemoStats
+    {
+        size_t m_lookups;       // calls of memoized rules
+        size_t m_hits;          // answered from the memo
+        size_t m_tokens_saved;  // tokens not parsed again thanks to hits
+        size_t m_evictions;     // live entries overwritten by others
+
+        MemoStats() : m_lookups(0), m_hits(0), m_tokens_saved(0), m_evictions(0)
+        {
+        }
+        void merge(const MemoStats& other)
+        {
+            m_lookups += other.m_lookups;
+            m_hits += other.m_hits;
+            m_tokens_saved += other.m_tokens_saved;
+            m_evictions += other.m_evictions;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // NameTable --- typedef-names and enumeration-constants in scope
+    //
+    // A hash table of the names with an undo log of the changes. A scope
+    // or a checkpoint is a position in the log; going back to it undoes the
+    // changes made since, so it costs O(names declared since).
+
+    class NameTable
+    {
+    public:
+        enum
+        {
+            TYPEDEF_NAME = 1,
+            ENUM_CONSTANT = 2
+        };
+
+        NameTable();
+
+        bool is_typedef_name(const string_type& name) const;
+        bool is_enum_constant(const string_type& name) const;
+        bool add(const string_type& name, unsigned char kind);
+
+        size_t checkpoint() const;
+        bool rollback(size_t checkpoint);
+        void push_scope();
+        bool pop_scope();
+        bool replay(const NameTable& table, size_t checkpoint);
+
+        // hides the names added from the snapshot up to now
+        void view(size_t snapshot);
+        void view_all();
+
+        size_t size() const;
+        void clear();
+
+    protected:
+        // the position in the log where each kind was added, or NONE
+        enum { NONE = 0xFFFFFFFF };
+        struct Entry
+        {
+            unsigned int m_typedef_at;
+            unsigned int m_enum_at;
+
+            Entry() : m_typedef_at(NONE), m_enum_at(NONE)
+            {
+            }
+        };
+        typedef std::unordered_map<string_type, Entry> map_type;
+        typedef std::pair<map_type::value_type *, Entry> undo_type;
+        map_type                m_map;
+        std::vector<undo_type>  m_undo;     // the entry and its old value
+        std::vector<size_t>     m_scopes;   // checkpoints of the open scopes
+        size_t                  m_view_end;     // the hidden part of the log
+        size_t                  m_view_begin;
+
+        bool visible(unsigned int at) const;
+
+    private:
+        // the undo log points into the table
+        NameTable(const NameTable&);
+        NameTable& operator=(const NameTable&);
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // ParserProfile --- counters of the rules of CParser
+    //
+    // Counted only if CR_PROFILE_PARSER is defined. A rule is a function
+    // that begins with CR_SHOW_STATUS(). A call succeeds if it returns a
+    // non-null value by CR_RETURN_AST, or if it returns otherwise after
+    // consuming tokens. The time is inclusive, so a recursive rule counts
+    // its inner calls again. A backtrack is an index() that goes back; it
+    // is charged to the innermost rule. A memoized rule shows as its parse_*
+    // function and counts only the calls that the memo did not answer.
+
+    class ParserProfile
+    {
+    public:
+        struct Rule
+        {
+            const char *m_name;
+            size_t      m_calls;
+            size_t      m_successes;
+            size_t      m_tokens;       // consumed by the successes
+            size_t      m_backtracks;
+            size_t      m_backtracked;  // tokens gone back over
+            double      m_seconds;
+
+            Rule() : m_name(""), m_calls(0), m_successes(0), m_tokens(0),
+                     m_backtracks(0), m_backtracked(0), m_seconds(0)
+            {
+            }
+        };
+
+        // a call of a rule, from CR_SHOW_STATUS() to its return
+        class Call
+        {
+        public:
+            Call(ParserProfile& profile, const char *name, const size_t& index);
+            ~Call();
+
+            template <typename T_VALUE>
+            T_VALUE result(T_VALUE value);
+
+        protected:
+            ParserProfile&  m_profile;
+            Rule *          m_rule;
+            const size_t&   m_index;
+            size_t          m_begin;
+            bool            m_returned;
+            std::chrono::steady_clock::time_point m_start;
+
+        private:
+            Call(const Call&);
+            Call& operator=(const Call&);
+        };
+
+        void backtrack(size_t count);
+        void merge(const ParserProfile& profile);
+        void clear();
+
+        std::vector<Rule> rules() const;    // the slowest first
+        void print_table(std::ostream& os) const;
+        void print_json(std::ostream& os) const;
+
+    protected:
+        // by __func__ of the rule
+        typedef std::unordered_map<const char *, Rule> map_type;
+        map_type                m_rules;
+        std::vector<Rule *>     m_stack;    // the calls going on
+    };
+
     /////////////////////////////////////////////////////////////////////////
     // CParser
 
@@ -44,18 +208,64 @@ namespace CodeReverse
     {
     public:
         CParser(Lexer& lexer);
+        ~CParser();
 
         bool do_parse();
 
+        // skim mode skips the function bodies
+        bool skim() const;
+        void skim(bool enable);
+
+        // lazy mode skips the function bodies but parses one on the first
+        // call of AST_function_definition::comp_stmt(), while the parser lives
+        bool lazy() const;
+        void lazy(bool enable);
+
+        // the number of threads that parse the external declarations
+        size_t jobs() const;
+        void jobs(size_t count);
+        // the chunks of the last do_parse() if it parsed on the threads;
+        // zero if it parsed sequentially
+        size_t chunks() const;
+
+        // the nodes of the AST; they live as long as the parser, or until
+        // the next do_parse() or clear()
+        const AST_arena& arena() const;
+
+        // the counters of the rules, if built with CR_PROFILE_PARSER
+        const ParserProfile& profile() const;
+
+        // recovery mode reports an external declaration that fails and
+        // skips it, so that the parse goes on; do_parse() then returns
+        // false but the AST has the rest
+        bool recover() const;
+        void recover(bool enable);
+
+        // compact mode turns the expressions into the compact form of
+        // AST_expr at the end of each external declaration and body, and
+        // throws the full form away
+        bool compact() const;
+        void compact(bool enable);
+
+        // packrat memoization of the rules that are re-parsed on backtracking
+        bool memoize() const;
+        void memoize(bool enable, size_t slots = 1 << 16);
+        const MemoStats& memo_stats() const;
+
+        // NOTE: The nodes live in the arena of the parser and s_p does not
+        //       own them, so the tree dies with the parser or by clear().
         s_p<AST_translation_unit> ast();
         void clear();
 
         TokenType type() const;
-        string_type str() const;
-        string_type fix() const;
+        TokenID id() const;
+        const string_type& str() const;
+        const string_type& fix() const;
         bool eof() const;
         void next();
         void prev();
+        bool is(TokenID id) const;
+        bool next_if(TokenID id);
         bool next_if(const char *psz);
         size_t paren_close();
         size_t brace_close();
@@ -68,12 +278,110 @@ namespace CodeReverse
     protected:
         Lexer& m_lexer;
         AuxInfo& m_aux;
+        size_t m_index;     // our own cursor, so that parsers can share a lexer
+        AST_arena m_arena;
+        AST_arena m_exprs;  // the full form of the expressions in compact mode
         s_p<AST_translation_unit> m_ast;
-        typedef std::set<string_type> typedef_names_type;
-        typedef_names_type m_typedef_names;
-        std::set<string_type> m_enum_constant_names;
+        NameTable m_names;
+        bool m_skim;
+        bool m_lazy;
+        size_t m_jobs;
+        bool m_recover;
+        bool m_compact;
+        ParserProfile m_profile;
+
+        // the link from the lazy bodies back to the parser
+        struct BodyParser : AST_body_parser
+        {
+            CParser *m_parser;
+
+            BodyParser(CParser *parser) : m_parser(parser)
+            {
+            }
+            virtual s_p<AST_compound_statement>
+            parse_body(size_t begin, size_t end, size_t names)
+            {
+                if (!m_parser)
+                    return nullptr;
+                return m_parser->parse_body(begin, end, names);
+            }
+        };
+        std::shared_ptr<BodyParser> m_body_parser;
+        s_p<AST_compound_statement> parse_body(size_t begin, size_t end, size_t names);
+        s_p<AST_compound_statement> visit_body(size_t begin, size_t end);
+
+        // a run of external declarations that parse_in_parallel() cuts
+        // off at the top level
+        struct Chunk
+        {
+            size_t m_begin;         // the token indexes
+            size_t m_end;
+            bool m_adds_names;      // may add typedef or enum names
+            size_t m_names;         // the checkpoint of the names it sees
+            std::vector<s_p<AST_external_declaration> > m_ext_decls;
+        };
+        typedef std::vector<Chunk> chunks_type;
+        size_t m_chunks;
+        bool parse_in_parallel();
+        bool cut_chunks(chunks_type& chunks) const;
+        bool visit_chunk(Chunk& chunk);
+        bool parse_chunks(chunks_type& chunks);
         typedef std::set<size_t> index_set_type;
 
+        // The memo maps (rule, token index) to the result and the end index.
+        // It is a direct-mapped table of a fixed number of slots, so a new
+        // entry evicts the one in its slot. An entry is valid only in the
+        // generation in which it was made; the generation goes up whenever
+        // a typedef or enum name comes or goes, and at each external
+        // declaration (no backtracking goes back over it).
+        enum MemoRule
+        {
+            MEMO_DECLARATOR,
+            MEMO_TYPE_NAME,
+            MEMO_UNARY_EXPRESSION,
+            MEMO_RULE_COUNT
+        };
+        struct MemoEntry
+        {
+            size_t m_key;
+            size_t m_generation;
+            size_t m_end;
+            s_p<AST_base> m_ast;
+        };
+        bool m_memoize;
+        size_t m_generation;
+        size_t m_memo_nodes;            // the entries made with a node
+        std::vector<MemoEntry> m_memo;  // power-of-two size
+        MemoStats m_memo_stats;
+
+        template <typename T_AST>
+        s_p<T_AST> memoized(MemoRule rule, s_p<T_AST> (CParser::*parse)());
+        void memo_flush();
+        void names_changed();
+
+        // A failed attempt gives its nodes back to the arena, unless the
+        // memo may still hand some of them out. The entries made since the
+        // mark are flushed if the nodes are given back anyway.
+        struct Mark
+        {
+            AST_arena::Mark m_arena;
+            AST_arena::Mark m_exprs;
+            size_t m_generation;
+            size_t m_memo_nodes;
+        };
+        Mark mark() const;
+        void give_back(const Mark& mark);
+
+        template <typename T_AST>
+        s_p<T_AST> make_expr();
+        template <typename T_AST>
+        s_p<T_AST> span(s_p<T_AST> node, size_t first) const;
+        template <typename T_AST>
+        s_p<T_AST> span(s_p<T_AST> node, size_t first, const Mark& mark);
+        std::nullptr_t span(std::nullptr_t, size_t first, const Mark& mark);
+        void compact_exprs(AST_external_declaration *ext_decl);
+        void compact_exprs(AST_compound_statement *comp_stmt);
+
         void add_typedef_name(const string_type& str);
         void care_of_typedefs(s_p<AST_declaration_specifiers> decl_specs, s_p<AST_declaration> decl);
         bool scan_function_attribute(attributes_type& attrs);
@@ -85,6 +393,7 @@ namespace CodeReverse
 
         s_p<AST_translation_unit> visit_translation_unit();
         s_p<AST_external_declaration> visit_external_declaration();
+        s_p<AST_external_declaration> skip_external_declaration();
         s_p<AST_function_definition> visit_function_definition();
         s_p<AST_declaration> visit_declaration();
         s_p<AST_declaration_specifiers> visit_declaration_specifiers();
@@ -130,16 +439,8 @@ namespace CodeReverse
         s_p<AST_expression> visit_expression();
         s_p<AST_assignment_expression> visit_assignment_expression();
         s_p<AST_conditional_expression> visit_conditional_expression();
-        s_p<AST_logical_or_expression> visit_logical_or_expression();
-        s_p<AST_logical_and_expression> visit_logical_and_expression();
-        s_p<AST_inclusive_or_expression> visit_inclusive_or_expression();
-        s_p<AST_exclusive_or_expression> visit_exclusive_or_expression();
-        s_p<AST_and_expression> visit_and_expression();
-        s_p<AST_equality_expression> visit_equality_expression();
-        s_p<AST_relational_expression> visit_relational_expression();
-        s_p<AST_shift_expression> visit_shift_expression();
-        s_p<AST_additive_expression> visit_additive_expression();
-        s_p<AST_multiplicative_expression> visit_multiplicative_expression();
+        s_p<AST_conditional_expression> visit_conditional_expression(s_p<AST_cast_expression> first);
+        s_p<AST_logical_or_expression> visit_logical_or_expression(s_p<AST_cast_expression> first);
         s_p<AST_cast_expression> visit_cast_expression();
         s_p<AST_unary_expression> visit_unary_expression();
         s_p<AST_postfix_expression> visit_postfix_expression();
@@ -159,16 +460,287 @@ namespace CodeReverse
         s_p<AST_iteration_statement> visit_iteration_statement();
         s_p<AST_jump_statement> visit_jump_statement();
         s_p<AST_asm_statement> visit_asm_statement();
+
+        // the alternatives of declaration-specifier by the first token
+        enum FirstOfDeclSpec
+        {
+            FIRST_NONE,
+            FIRST_STO_CLASS_SPEC,
+            FIRST_TYPE_SPEC,
+            FIRST_ATOMIC,       // type-specifier or type-qualifier
+            FIRST_TYPE_QUAL,
+            FIRST_FUNC_SPEC,
+            FIRST_ALIGN_SPEC
+        };
+        FirstOfDeclSpec first_of_declaration_specifier() const;
+
+        // precedence climbing of the binary operators
+        enum BinaryLevel
+        {
+            BL_NONE,
+            BL_LOGICAL_OR,      // ||
+            BL_LOGICAL_AND,     // &&
+            BL_INCLUSIVE_OR,    // |
+            BL_EXCLUSIVE_OR,    // ^
+            BL_AND,             // &
+            BL_EQUALITY,        // == !=
+            BL_RELATIONAL,      // < > <= >=
+            BL_SHIFT,           // << >>
+            BL_ADDITIVE,        // + -
+            BL_MULTIPLICATIVE,  // * / %
+            BL_CAST             // the operands
+        };
+        static int binary_level(TokenID id);
+        s_p<AST_base> lift_binary(s_p<AST_base> node, int from, int to);
+        s_p<AST_base> join_binary(int level, s_p<AST_base> left, TokenID op,
+                                  s_p<AST_base> right);
+
+        // the memoized rules
+        s_p<AST_declarator> parse_declarator();
+        s_p<AST_type_name> parse_type_name();
+        s_p<AST_unary_expression> parse_unary_expression();
     };
 
+    /////////////////////////////////////////////////////////////////////////
+    // NameTable inlines
+
+    inline NameTable::NameTable() : m_view_end(NONE), m_view_begin(0)
+    {
+    }
+    inline bool NameTable::visible(unsigned int at) const
+    {
+        return at != NONE && (at < m_view_end || at >= m_view_begin);
+    }
+    inline bool NameTable::is_typedef_name(const string_type& name) const
+    {
+        map_type::const_iterator it = m_map.find(name);
+        return it != m_map.end() && visible(it->second.m_typedef_at);
+    }
+    inline bool NameTable::is_enum_constant(const string_type& name) const
+    {
+        map_type::const_iterator it = m_map.find(name);
+        return it != m_map.end() && visible(it->second.m_enum_at);
+    }
+    // returns true if the name was not of the kind yet
+    inline bool NameTable::add(const string_type& name, unsigned char kind)
+    {
+        map_type::value_type& entry = *m_map.insert(std::make_pair(name, Entry())).first;
+        unsigned int& at = (kind == TYPEDEF_NAME ? entry.second.m_typedef_at
+                                                 : entry.second.m_enum_at);
+        if (visible(at))
+            return false;
+        assert(m_undo.size() < NONE);
+        m_undo.push_back(undo_type(&entry, entry.second));
+        at = unsigned(m_undo.size() - 1);
+        return true;
+    }
+    inline size_t NameTable::checkpoint() const
+    {
+        return m_undo.size();
+    }
+    // returns true if anything was undone
+    inline bool NameTable::rollback(size_t checkpoint)
+    {
+        assert(checkpoint <= m_undo.size());
+        bool changed = (checkpoint < m_undo.size());
+        while (m_undo.size() > checkpoint)
+        {
+            undo_type& undo = m_undo.back();
+            if (undo.second.m_typedef_at != NONE || undo.second.m_enum_at != NONE)
+                undo.first->second = undo.second;
+            else
+                m_map.erase(m_map.find(undo.first->first));
+            m_undo.pop_back();
+        }
+        return changed;
+    }
+    inline void NameTable::push_scope()
+    {
+        m_scopes.push_back(checkpoint());
+    }
+    // returns true if any name of the scope went away
+    inline bool NameTable::pop_scope()
+    {
+        assert(!m_scopes.empty());
+        size_t scope = m_scopes.back();
+        m_scopes.pop_back();
+        return rollback(scope);
+    }
+    // A snapshot is a checkpoint. The names that the log had by then are
+    // seen, and so are the names added from now on, but not the ones in
+    // between. The log below a checkpoint is never undone once the
+    // external declaration that made it has been parsed.
+    inline void NameTable::view(size_t snapshot)
+    {
+        assert(snapshot <= m_undo.size());
+        m_view_end = snapshot;
+        m_view_begin = m_undo.size();
+    }
+    inline void NameTable::view_all()
+    {
+        m_view_end = NONE;
+        m_view_begin = 0;
+    }
+    // Adds the names that the log of the table has from our checkpoint up
+    // to its checkpoint, so that we see what it saw there. The log of the
+    // table must be as it is after a parse; returns true if we changed.
+    inline bool NameTable::replay(const NameTable& table, size_t checkpoint)
+    {
+        assert(checkpoint <= table.m_undo.size());
+        bool changed = false;
+        for (size_t i = m_undo.size(); i < checkpoint; ++i)
+        {
+            const map_type::value_type& entry = *table.m_undo[i].first;
+            if (entry.second.m_typedef_at == i)
+                changed |= add(entry.first, TYPEDEF_NAME);
+            else if (entry.second.m_enum_at == i)
+                changed |= add(entry.first, ENUM_CONSTANT);
+        }
+        return changed;
+    }
+    inline size_t NameTable::size() const
+    {
+        return m_map.size();
+    }
+    inline void NameTable::clear()
+    {
+        m_map.clear();
+        m_undo.clear();
+        m_scopes.clear();
+        view_all();
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // ParserProfile inlines
+
+    inline ParserProfile::Call::Call(ParserProfile& profile, const char *name,
+                                     const size_t& index)
+        : m_profile(profile), m_rule(&profile.m_rules[name]), m_index(index),
+          m_begin(index), m_returned(false),
+          m_start(std::chrono::steady_clock::now())
+    {
+        m_rule->m_name = name;
+        m_profile.m_stack.push_back(m_rule);
+    }
+    inline ParserProfile::Call::~Call()
+    {
+        ++m_rule->m_calls;
+        if (!m_returned && m_index > m_begin)
+        {
+            ++m_rule->m_successes;
+            m_rule->m_tokens += m_index - m_begin;
+        }
+        std::chrono::duration<double> spent =
+            std::chrono::steady_clock::now() - m_start;
+        m_rule->m_seconds += spent.count();
+        m_profile.m_stack.pop_back();
+    }
+    template <typename T_VALUE>
+    inline T_VALUE ParserProfile::Call::result(T_VALUE value)
+    {
+        m_returned = true;
+        if (value)
+        {
+            ++m_rule->m_successes;
+            m_rule->m_tokens += m_index - m_begin;
+        }
+        return value;
+    }
+    inline void ParserProfile::backtrack(size_t count)
+    {
+        if (m_stack.empty())
+            return;
+        ++m_stack.back()->m_backtracks;
+        m_stack.back()->m_backtracked += count;
+    }
+    inline void ParserProfile::merge(const ParserProfile& profile)
+    {
+        for (auto& pair : profile.m_rules)
+        {
+            Rule& rule = m_rules[pair.first];
+            rule.m_name = pair.second.m_name;
+            rule.m_calls += pair.second.m_calls;
+            rule.m_successes += pair.second.m_successes;
+            rule.m_tokens += pair.second.m_tokens;
+            rule.m_backtracks += pair.second.m_backtracks;
+            rule.m_backtracked += pair.second.m_backtracked;
+            rule.m_seconds += pair.second.m_seconds;
+        }
+    }
+    inline void ParserProfile::clear()
+    {
+        m_rules.clear();
+    }
+    inline std::vector<ParserProfile::Rule> ParserProfile::rules() const
+    {
+        std::vector<Rule> rules;
+        for (auto& pair : m_rules)
+        {
+            rules.push_back(pair.second);
+        }
+        std::sort(rules.begin(), rules.end(),
+            [](const Rule& a, const Rule& b) {
+                return a.m_seconds > b.m_seconds;
+            });
+        return rules;
+    }
+    inline void ParserProfile::print_table(std::ostream& os) const
+    {
+        os << std::left << std::setw(36) << "rule" << std::right
+           << std::setw(12) << "calls" << std::setw(12) << "fails"
+           << std::setw(12) << "tokens" << std::setw(12) << "backtracks"
+           << std::setw(12) << "back-tokens" << std::setw(12) << "seconds"
+           << std::endl;
+        for (auto& rule : rules())
+        {
+            os << std::left << std::setw(36) << rule.m_name << std::right
+               << std::setw(12) << rule.m_calls
+               << std::setw(12) << rule.m_calls - rule.m_successes
+               << std::setw(12) << rule.m_tokens
+               << std::setw(12) << rule.m_backtracks
+               << std::setw(12) << rule.m_backtracked
+               << std::setw(12) << std::fixed << std::setprecision(4)
+               << rule.m_seconds << std::endl;
+        }
+    }
+    inline void ParserProfile::print_json(std::ostream& os) const
+    {
+        os << "[";
+        const char *sep = "\n";
+        for (auto& rule : rules())
+        {
+            os << sep << "  {\"rule\": \"" << rule.m_name << "\""
+               << ", \"calls\": " << rule.m_calls
+               << ", \"successes\": " << rule.m_successes
+               << ", \"failures\": " << rule.m_calls - rule.m_successes
+               << ", \"tokens\": " << rule.m_tokens
+               << ", \"backtracks\": " << rule.m_backtracks
+               << ", \"backtracked_tokens\": " << rule.m_backtracked
+               << ", \"seconds\": " << std::fixed << std::setprecision(6)
+               << rule.m_seconds << "}";
+            sep = ",\n";
+        }
+        os << "\n]" << std::endl;
+    }
+
     /////////////////////////////////////////////////////////////////////////
     // CParser inlines
 
     inline CParser::CParser(Lexer& lexer)
-        : m_lexer(lexer), m_aux(lexer.m_aux)
+        : m_lexer(lexer), m_aux(lexer.m_aux), m_index(0),
+          m_skim(false), m_lazy(false), m_jobs(1), m_recover(false),
+          m_compact(false),
+          m_body_parser(std::make_shared<BodyParser>(this)), m_chunks(0),
+          m_generation(1), m_memo_nodes(0)
+    {
+        memoize(true);
+        m_names.add("__builtin_va_list", NameTable::TYPEDEF_NAME);
+        m_names.add("va_list", NameTable::TYPEDEF_NAME);
+    }
+    inline CParser::~CParser()
     {
-        m_typedef_names.insert("__builtin_va_list");
-        m_typedef_names.insert("va_list");
+        // the lazy bodies left can no longer be parsed
+        m_body_parser->m_parser = NULL;
     }
 
     inline s_p<AST_translation_unit> CParser::ast()
@@ -179,86 +751,506 @@ namespace CodeReverse
     {
         m_ast.reset();
         m_lexer.clear();
+        memo_flush();
+        m_exprs.clear();
+        m_arena.clear();
     }
 
-    inline TokenType CParser::type() const
+    inline bool CParser::skim() const
     {
-        return m_lexer.type();
+        return m_skim;
     }
-    inline string_type CParser::str() const
+    inline void CParser::skim(bool enable)
     {
-        return m_lexer.str();
+        m_skim = enable;
     }
-    inline string_type CParser::fix() const
+
+    inline bool CParser::lazy() const
     {
-        return m_lexer.fix();
+        return m_lazy;
     }
-    inline bool CParser::eof() const
+    inline void CParser::lazy(bool enable)
     {
-        return m_lexer.eof();
+        m_lazy = enable;
     }
-    inline void CParser::next()
+    // parses a body skipped in lazy mode, seeing the names of its time
+    inline s_p<AST_compound_statement>
+    CParser::parse_body(size_t begin, size_t end, size_t names)
     {
-        m_lexer.next();
+        auto i = index();
+        m_names.view(names);
+        auto comp_stmt = visit_body(begin, end);
+        if (!comp_stmt)
+        {
+            m_aux.add_error(m_lexer.tokens().pos(begin),
+                            "parse error in function body");
+        }
+        m_names.view_all();
+        memo_flush();
+        index(i);
+        return comp_stmt;
     }
-    inline void CParser::prev()
+    // parses a function body from '{' at begin up to end exactly
+    inline s_p<AST_compound_statement>
+    CParser::visit_body(size_t begin, size_t end)
     {
-        m_lexer.prev();
+        memo_flush();
+        m_exprs.clear();
+        index(begin);
+        auto comp_stmt = visit_compound_statement();
+        if (comp_stmt && index() == end)
+        {
+            if (m_compact)
+                compact_exprs(comp_stmt.get());
+            return comp_stmt;
+        }
+        return nullptr;
     }
-    inline bool CParser::next_if(const char *psz)
+
+    inline const AST_arena& CParser::arena() const
     {
-        if (str() == psz)
+        return m_arena;
+    }
+
+    inline const ParserProfile& CParser::profile() const
+    {
+        return m_profile;
+    }
+
+    inline bool CParser::recover() const
+    {
+        return m_recover;
+    }
+    inline void CParser::recover(bool enable)
+    {
+        m_recover = enable;
+    }
+
+    inline bool CParser::compact() const
+    {
+        return m_compact;
+    }
+    inline void CParser::compact(bool enable)
+    {
+        m_compact = enable;
+    }
+    // the nodes of the full form of the expressions go to m_exprs in
+    // compact mode, to be thrown away after compact_exprs()
+    template <typename T_AST>
+    inline s_p<T_AST> CParser::make_expr()
+    {
+        if (m_compact)
+            return m_exprs.make<T_AST>();
+        return m_arena.make<T_AST>();
+    }
+    // gives the node the tokens [first, index()) unless it has its span
+    // already, as a node handed out by the memo or by a deeper rule does
+    template <typename T_AST>
+    inline s_p<T_AST> CParser::span(s_p<T_AST> node, size_t first) const
+    {
+        if (node && !node->m_last)
         {
-            next();
-            return true;
+            node->m_first = (unsigned int)first;
+            node->m_last = (unsigned int)index();
         }
-        return false;
+        return node;
     }
-    inline size_t CParser::paren_close()
+    // NOTE: A rule that fails gives back what it made before it found out,
+    //       so that no node is left in the arena without a span.
+    template <typename T_AST>
+    inline s_p<T_AST>
+    CParser::span(s_p<T_AST> node, size_t first, const Mark& mark)
+    {
+        if (!node)
+            give_back(mark);
+        return span(node, first);
+    }
+    inline std::nullptr_t
+    CParser::span(std::nullptr_t, size_t, const Mark& mark)
+    {
+        give_back(mark);
+        return nullptr;
+    }
+    // The memo may hold the full form, so it goes too.
+    inline void CParser::compact_exprs(AST_external_declaration *ext_decl)
+    {
+        ExprCompactor compactor(m_arena);
+        compactor.walk(ext_decl);
+        memo_flush();
+        m_exprs.clear();
+    }
+    inline void CParser::compact_exprs(AST_compound_statement *comp_stmt)
+    {
+        ExprCompactor compactor(m_arena);
+        compactor.walk(comp_stmt);
+        memo_flush();
+        m_exprs.clear();
+    }
+
+    inline size_t CParser::jobs() const
+    {
+        return m_jobs;
+    }
+    inline void CParser::jobs(size_t count)
     {
-        int nest = 0;
-        for (size_t i = index(); i < m_lexer.size(); ++i)
+        m_jobs = count;
+    }
+    inline size_t CParser::chunks() const
+    {
+        return m_chunks;
+    }
+    // Parses the external declarations on m_jobs threads. The pre-pass
+    // cuts the top level into chunks and parses here, in order, the chunks
+    // that may add typedef-names or enumeration-constants, so that each of
+    // the other chunks has the checkpoint of the names it must see. Those
+    // are then parsed on the threads. The result is the same as that of
+    // visit_translation_unit(). If anything fails, returns false leaving
+    // things as they were, so that the sequential parse can tell where.
+    inline bool CParser::parse_in_parallel()
+    {
+        auto i = index();
+        auto names = m_names.checkpoint();
+        auto errors = m_aux.m_errors.size();
+        auto nodes = m_arena.mark();
+
+        chunks_type chunks;
+        bool ok = cut_chunks(chunks);
+        for (size_t k = 0; ok && k < chunks.size(); ++k)
+        {
+            chunks[k].m_names = m_names.checkpoint();
+            if (chunks[k].m_adds_names)
+                ok = visit_chunk(chunks[k]);
+        }
+        if (!ok || !parse_chunks(chunks))
+        {
+            index(i);
+            if (m_names.rollback(names))
+                names_changed();
+            m_aux.m_errors.resize(errors);
+            memo_flush();
+            m_exprs.clear();
+            m_arena.rollback(nodes);
+            return false;
+        }
+
+        auto trans_unit = m_arena.make<AST_translation_unit>();
+        for (auto& chunk : chunks)
         {
-            string_type& str = m_lexer[i].m_str;
-            if (str == "(")
+            for (auto& ext_decl : chunk.m_ext_decls)
             {
-                ++nest;
+                trans_unit->push_back(ext_decl);
+            }
+        }
+        if (chunks.size())
+            index(chunks.back().m_end);
+        m_ast = span(trans_unit, i);
+        m_chunks = chunks.size();
+        return true;
+    }
+    // The pre-pass cuts the tokens up to the end after each ';' and each
+    // function body of the top level, jumping over the brackets by their
+    // index. A '{' right after ')' begins a function body unless ';' comes
+    // after its '}'. A chunk that is cut wrong, as a K&R definition is,
+    // fails to parse. A chunk may add names if 'typedef' or 'enum' is in
+    // it outside a function body.
+    inline bool CParser::cut_chunks(chunks_type& chunks) const
+    {
+        const TokenStream& tokens = m_lexer.tokens();
+        if (!tokens.brackets_indexed())
+            return false;
+
+        Chunk chunk;
+        chunk.m_begin = index();
+        chunk.m_adds_names = false;
+        chunk.m_names = 0;
+        size_t i = chunk.m_begin;
+        while (i < tokens.size() && tokens.type(i) != TK_EOF)
+        {
+            TokenID id = tokens.id(i);
+            bool cut = (id == SYM_SEMICOLON);
+            if (id == SYM_L_PAREN || id == SYM_L_BRACKET || id == SYM_L_BRACE)
+            {
+                size_t close = tokens.matching(i);
+                if (close >= tokens.size())
+                    return false;
+                cut = (id == SYM_L_BRACE && i > chunk.m_begin &&
+                       tokens.id(i - 1) == SYM_R_PAREN &&
+                       tokens.id(close + 1) != SYM_SEMICOLON);
+                if (!cut)
+                {
+                    for (size_t k = i + 1; k < close; ++k)
+                    {
+                        if (tokens.id(k) == KW_TYPEDEF || tokens.id(k) == KW_ENUM)
+                            chunk.m_adds_names = true;
+                    }
+                }
+                i = close;
             }
-            else if (str == ")")
+            else if (id == KW_TYPEDEF || id == KW_ENUM)
             {
-                --nest;
-                if (nest == 0)
-                    return i + 1;
+                chunk.m_adds_names = true;
+            }
+            ++i;
+
+            if (cut)
+            {
+                chunk.m_end = i;
+                chunks.push_back(chunk);
+                chunk.m_begin = i;
+                chunk.m_adds_names = false;
             }
         }
-        return m_lexer.size();
+        if (chunk.m_begin < i)
+        {
+            chunk.m_end = i;
+            chunks.push_back(chunk);
+        }
+        return true;
     }
-    inline size_t CParser::brace_close()
+    // parses the external declarations from the beginning of the chunk up
+    // to its end exactly
+    inline bool CParser::visit_chunk(Chunk& chunk)
     {
-        int nest = 0;
-        for (size_t i = index(); i < m_lexer.size(); ++i)
+        index(chunk.m_begin);
+        while (index() < chunk.m_end)
+        {
+            memo_flush();
+            m_exprs.clear();
+            auto ext_decl = visit_external_declaration();
+            if (!ext_decl || index() > chunk.m_end)
+                return false;
+            if (m_compact)
+                compact_exprs(ext_decl.get());
+            chunk.m_ext_decls.push_back(ext_decl);
+        }
+        return true;
+    }
+    // The chunks that add no names are cut into runs of about the same
+    // number of tokens, several runs a thread. A thread takes the next run
+    // by the counter and parses it on its own parser over our lexer; as the
+    // runs come in order, its names only move forward. A chunk that adds a
+    // name after all fails, as the chunks after it did not see the name.
+    inline bool CParser::parse_chunks(chunks_type& chunks)
+    {
+        size_t total = 0;
+        for (auto& chunk : chunks)
         {
-            string_type& str = m_lexer[i].m_str;
-            if (str == "{")
+            if (!chunk.m_adds_names)
+                total += chunk.m_end - chunk.m_begin;
+        }
+        size_t run_size = total / (m_jobs * 8) + 1;
+        std::vector<size_t> runs;   // the first chunk of each run
+        size_t tokens = run_size;
+        for (size_t k = 0; k < chunks.size(); ++k)
+        {
+            if (chunks[k].m_adds_names)
+                continue;
+            if (tokens >= run_size)
             {
-                ++nest;
+                runs.push_back(k);
+                tokens = 0;
             }
-            else if (str == "}")
+            tokens += chunks[k].m_end - chunks[k].m_begin;
+        }
+        runs.push_back(chunks.size());
+
+        m_lexer.m_tokens.intern_all();
+
+        std::atomic<size_t> next_run(0);
+        std::atomic<bool> failed(false);
+        std::mutex mutex;
+        auto work = [&]()
+        {
+            CParser worker(m_lexer);
+            worker.memoize(m_memoize, m_memo.size());
+            worker.compact(m_compact);
+            worker.m_names.clear();
+            for (;;)
             {
-                --nest;
-                if (nest == 0)
-                    return i + 1;
+                size_t run = next_run++;
+                if (run + 1 >= runs.size() || failed)
+                    break;
+                for (size_t k = runs[run]; k < runs[run + 1]; ++k)
+                {
+                    auto& chunk = chunks[k];
+                    if (chunk.m_adds_names)
+                        continue;
+                    if (worker.m_names.replay(m_names, chunk.m_names))
+                        worker.names_changed();
+                    auto names = worker.m_names.checkpoint();
+                    if (!worker.visit_chunk(chunk) ||
+                        worker.m_names.checkpoint() != names)
+                    {
+                        failed = true;
+                        break;
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            m_arena.adopt(worker.m_arena);
+            m_profile.merge(worker.m_profile);
+            m_memo_stats.merge(worker.m_memo_stats);
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < m_jobs; ++i)
+        {
+            threads.push_back(std::thread(work));
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        return !failed;
+    }
+
+    inline bool CParser::memoize() const
+    {
+        return m_memoize;
+    }
+    inline void CParser::memoize(bool enable, size_t slots)
+    {
+        assert((slots & (slots - 1)) == 0);
+        m_memoize = enable;
+        m_memo.clear();
+        if (enable)
+            m_memo.resize(slots ? slots : 1);
+    }
+    inline const MemoStats& CParser::memo_stats() const
+    {
+        return m_memo_stats;
+    }
+    // invalidates all the entries
+    inline void CParser::memo_flush()
+    {
+        ++m_generation;
+    }
+    inline void CParser::names_changed()
+    {
+        memo_flush();
+    }
+    inline CParser::Mark CParser::mark() const
+    {
+        Mark mark = { m_arena.mark(), m_exprs.mark(), m_generation, m_memo_nodes };
+        return mark;
+    }
+    inline void CParser::give_back(const Mark& mark)
+    {
+        if (m_generation != mark.m_generation ||
+            m_memo_nodes == mark.m_memo_nodes)
+        {
+            if (m_memo_nodes != mark.m_memo_nodes)
+                memo_flush();
+            m_arena.rollback(mark.m_arena);
+            m_exprs.rollback(mark.m_exprs);
+        }
+    }
+    template <typename T_AST>
+    inline s_p<T_AST>
+    CParser::memoized(MemoRule rule, s_p<T_AST> (CParser::*parse)())
+    {
+        if (!m_memoize)
+            return (this->*parse)();
+
+        ++m_memo_stats.m_lookups;
+        size_t i = index();
+        size_t key = i * MEMO_RULE_COUNT + rule;
+        MemoEntry *entry = &m_memo[key & (m_memo.size() - 1)];
+        if (entry->m_generation == m_generation)
+        {
+            if (entry->m_key == key)
+            {
+                ++m_memo_stats.m_hits;
+                m_memo_stats.m_tokens_saved += entry->m_end - i;
+                index(entry->m_end);
+                return static_pointer_cast<T_AST>(entry->m_ast);
             }
+            ++m_memo_stats.m_evictions;
+        }
+
+        s_p<T_AST> ast = (this->*parse)();
+
+        entry = &m_memo[key & (m_memo.size() - 1)];
+        entry->m_key = key;
+        entry->m_generation = m_generation;
+        entry->m_end = index();
+        entry->m_ast = ast;
+        if (ast)
+            ++m_memo_nodes;
+        return ast;
+    }
+
+    inline TokenType CParser::type() const
+    {
+        return m_lexer.tokens().type(m_index);
+    }
+    inline TokenID CParser::id() const
+    {
+        return m_lexer.tokens().id(m_index);
+    }
+    inline const string_type& CParser::str() const
+    {
+        return m_lexer.tokens().str(m_index);
+    }
+    inline const string_type& CParser::fix() const
+    {
+        return m_lexer.tokens().fix(m_index);
+    }
+    inline bool CParser::eof() const
+    {
+        return type() == TK_EOF;
+    }
+    inline void CParser::next()
+    {
+        if (m_index + 1 <= m_lexer.size())
+            ++m_index;
+    }
+    inline void CParser::prev()
+    {
+        if (m_index > 0)
+            --m_index;
+    }
+    inline bool CParser::is(TokenID id) const
+    {
+        return this->id() == id;
+    }
+    inline bool CParser::next_if(TokenID id)
+    {
+        if (is(id))
+        {
+            next();
+            return true;
         }
-        return m_lexer.size();
+        return false;
+    }
+    inline bool CParser::next_if(const char *psz)
+    {
+        if (str() == psz)
+        {
+            next();
+            return true;
+        }
+        return false;
+    }
+    inline size_t CParser::paren_close()
+    {
+        return std::min(m_lexer.paren_close(index()) + 1, m_lexer.size());
+    }
+    inline size_t CParser::brace_close()
+    {
+        return std::min(m_lexer.brace_close(index()) + 1, m_lexer.size());
     }
     inline size_t CParser::index() const
     {
-        return m_lexer.index();
+        return m_index;
     }
     inline void CParser::index(size_t pos)
     {
-        m_lexer.index(pos);
+#ifdef CR_PROFILE_PARSER
+        if (pos < m_index)
+            m_profile.backtrack(m_index - pos);
+#endif
+        m_index = pos;
     }
     inline Position CParser::pos() const
     {
@@ -266,22 +1258,34 @@ namespace CodeReverse
     }
     inline Position CParser::parse_pos() const
     {
-        return m_lexer[index()].m_pos;
+        return m_lexer.tokens().pos(index());
     }
     inline bool CParser::do_parse()
     {
+        m_ast.reset();
+        memo_flush();
+        m_exprs.clear();
+        m_arena.clear();
+        m_chunks = 0;
+
+        size_t errors = m_aux.m_errors.size();
+        if (m_jobs > 1 && !m_skim && !m_lazy && parse_in_parallel())
+            return m_aux.m_errors.size() == errors;
+
         m_ast = visit_translation_unit();
+        memo_flush();
         if (!m_ast)
         {
             m_aux.add_error(parse_pos(), "parse error (%d): %s",
                             int(type()), str().c_str());
         }
-        return !!m_ast;
+        return m_ast && m_aux.m_errors.size() == errors;
     }
 
     inline void CParser::add_typedef_name(const string_type& str)
     {
-        m_typedef_names.insert(str);
+        if (m_names.add(str, NameTable::TYPEDEF_NAME))
+            names_changed();
     }
 
     inline void CParser::care_of_typedefs(
@@ -338,8 +1342,8 @@ namespace CodeReverse
     inline bool CParser::scan_function_attribute(attributes_type& attrs)
     {
         CR_SHOW_STATUS();
-        if (str() == "__cdecl" || str() == "__fastcall" ||
-            str() == "__stdcall")
+        if (is(KW___CDECL) || is(KW___FASTCALL) ||
+            is(KW___STDCALL))
         {
             attrs[str().substr(2)] = "";
             next();
@@ -372,18 +1376,18 @@ namespace CodeReverse
     inline bool CParser::scan_declspec(attributes_type& attrs)
     {
         CR_SHOW_STATUS();
-        if (next_if("__declspec") && next_if("("))
+        if (next_if(KW___DECLSPEC) && next_if(SYM_L_PAREN))
         {
             size_t level = 1;
             string_type name = str(), value;
             next();
             for (;;)
             {
-                if (str() == "(")
+                if (is(SYM_L_PAREN))
                 {
                     ++level;
                 }
-                else if (str() == ")")
+                else if (is(SYM_R_PAREN))
                 {
                     --level;
                     if (level == 0)
@@ -404,17 +1408,17 @@ namespace CodeReverse
     inline bool CParser::scan_gnu_attribute(attributes_type& attrs)
     {
         CR_SHOW_STATUS();
-        if (next_if("__attribute__"))
+        if (next_if(KW___ATTRIBUTE__))
         {
             auto i = paren_close();
-            next_if("("); next_if("("); // ))
+            next_if(SYM_L_PAREN); next_if(SYM_L_PAREN); // ))
 
             do
             {
                 string_type name = str(), value;
                 trim_underline(name);
                 next();
-                if (str() == "(")
+                if (is(SYM_L_PAREN))
                 {
                     auto k1 = paren_close();
                     for (auto k0 = index(); k0 < k1; ++k0, next())
@@ -443,7 +1447,7 @@ namespace CodeReverse
                 }
                 //std::cout << name << "##" << value << std::endl;
                 attrs[name] = value;
-            } while (next_if(","));
+            } while (next_if(SYM_COMMA));
 
             index(i);
             return true;
@@ -458,9 +1462,11 @@ namespace CodeReverse
     inline s_p<AST_translation_unit> CParser::visit_translation_unit()
     {
         CR_SHOW_STATUS();
-        auto trans_unit = m_s<AST_translation_unit>();
+        auto trans_unit = m_arena.make<AST_translation_unit>();
         for (;;)
         {
+            memo_flush();
+            m_exprs.clear();
             auto i = index();
             //if (parse_pos().file().find("winnt.h") != string_type::npos &&
             //    parse_pos().line() >= 11878)
@@ -469,8 +1475,17 @@ namespace CodeReverse
             //}
             if (auto ext_decl = visit_external_declaration())
             {
+                if (m_compact)
+                    compact_exprs(ext_decl.get());
                 trans_unit->push_back(ext_decl);
             }
+            else if (m_recover && !eof())
+            {
+                index(i);
+                m_aux.add_error(parse_pos(), "parse error (%d): %s",
+                                int(type()), str().c_str());
+                trans_unit->push_back(skip_external_declaration());
+            }
             else
             {
                 index(i);
@@ -487,28 +1502,68 @@ namespace CodeReverse
     inline s_p<AST_external_declaration> CParser::visit_external_declaration()
     {
         CR_SHOW_STATUS();
-        auto extern_decl = m_s<AST_external_declaration>();
         auto i = index();
+        auto names = m_names.checkpoint();
+        auto nodes = mark();
         if (auto decl = visit_declaration())
         {
+            auto extern_decl = m_arena.make<AST_external_declaration>();
             extern_decl->m_decl = decl;
             CR_RETURN_AST(extern_decl);
         }
         index(i);
+        if (m_names.rollback(names))
+            names_changed();
+        give_back(nodes);
         if (auto func_def = visit_function_definition())
         {
+            auto extern_decl = m_arena.make<AST_external_declaration>();
             extern_decl->m_func_def = func_def;
             CR_RETURN_AST(extern_decl);
         }
         index(i);
+        if (m_names.rollback(names))
+            names_changed();
+        memo_flush();
+        give_back(nodes);
         CR_RETURN_AST(nullptr);
     }
 
+    // NOTE: Skips to the next synchronization point at the top level, that
+    //       is, past a ';' or past a '}' and a ';' right after it. The
+    //       brackets are jumped over by the index of them.
+    inline s_p<AST_external_declaration> CParser::skip_external_declaration()
+    {
+        CR_SHOW_STATUS();
+        auto skipped = m_arena.make<AST_skipped_declaration>();
+        skipped->m_begin = index();
+        while (!eof())
+        {
+            if (next_if(SYM_SEMICOLON))
+                break;
+            if (is(SYM_L_BRACE))
+            {
+                index(std::min(brace_close(), m_lexer.size() - 1));
+                next_if(SYM_SEMICOLON);
+                break;
+            }
+            if (is(SYM_L_PAREN))
+                index(std::min(paren_close(), m_lexer.size() - 1));
+            else
+                next();
+        }
+        skipped->m_end = index();
+
+        auto extern_decl = m_arena.make<AST_external_declaration>();
+        extern_decl->m_skipped = skipped;
+        CR_RETURN_AST(extern_decl);
+    }
+
     // function-definition = declaration-specifiers, {function-attribute}, declarator, [declaration-list], compound-statement;
     inline s_p<AST_function_definition> CParser::visit_function_definition()
     {
         CR_SHOW_STATUS();
-        auto func_def = m_s<AST_function_definition>();
+        auto func_def = m_arena.make<AST_function_definition>();
         if (auto decl_specs = visit_declaration_specifiers())
         {
             func_def->m_decl_specs = decl_specs;
@@ -528,14 +1583,29 @@ namespace CodeReverse
                     i = index();
                 }
                 index(i);
-                auto names_save = m_typedef_names;
+                func_def->m_body_begin = index();
+                if ((m_skim || m_lazy) && is(SYM_L_BRACE))
+                {
+                    // jump over the body, keeping only its token range
+                    auto k = brace_close();
+                    if (k < m_lexer.size())
+                    {
+                        index(k);
+                        func_def->m_body_end = k;
+                        if (m_lazy)
+                        {
+                            func_def->m_body_parser = m_body_parser;
+                            func_def->m_names = m_names.checkpoint();
+                        }
+                        CR_RETURN_AST(func_def);
+                    }
+                }
                 if (auto comp_stmt = visit_compound_statement())
                 {
                     func_def->m_comp_stmt = comp_stmt;
-                    m_typedef_names = names_save;
+                    func_def->m_body_end = index();
                     CR_RETURN_AST(func_def);
                 }
-                m_typedef_names = names_save;
             }
         }
         CR_RETURN_AST(nullptr);
@@ -547,13 +1617,13 @@ namespace CodeReverse
     inline s_p<AST_declaration> CParser::visit_declaration()
     {
         CR_SHOW_STATUS();
-        auto decl = m_s<AST_declaration>();
-        if (next_if(";"))
+        auto decl = m_arena.make<AST_declaration>();
+        if (next_if(SYM_SEMICOLON))
         {
             CR_RETURN_AST(decl);
         }
 
-        bool is_typedef = (str() == "typedef");
+        bool is_typedef = is(KW_TYPEDEF);
 
         auto i = index();
         if (auto decl_specs = visit_declaration_specifiers())
@@ -572,7 +1642,7 @@ namespace CodeReverse
                 {
                     i = index();
                 }
-                if (next_if(";"))
+                if (next_if(SYM_SEMICOLON))
                 {
                     care_of_typedefs(decl_specs, decl);
                     CR_RETURN_AST(decl);
@@ -604,7 +1674,7 @@ namespace CodeReverse
     inline s_p<AST_declaration_specifiers> CParser::visit_declaration_specifiers()
     {
         CR_SHOW_STATUS();
-        auto decl_specs = m_s<AST_declaration_specifiers>();
+        auto decl_specs = m_arena.make<AST_declaration_specifiers>();
         auto i = index();
         if (auto decl_spec = visit_declaration_specifier())
         {
@@ -625,54 +1695,128 @@ namespace CodeReverse
     //                       | type-qualifier
     //                       | function-specifier
     //                       | alignment-specifier;
+    // NOTE: The alternative is chosen by the first token. See
+    //       first_of_declaration_specifier.
     inline s_p<AST_declaration_specifier> CParser::visit_declaration_specifier()
     {
         CR_SHOW_STATUS();
-        auto decl_spec = m_s<AST_declaration_specifier>();
+        auto decl_spec = m_arena.make<AST_declaration_specifier>();
         auto i = index();
-        if (auto sto_class_spec = visit_storage_class_specifier())
-        {
-            decl_spec->m_sto_class_spec = sto_class_spec;
-            decl_spec->m_type = AST_declaration_specifier::DS_STO_CLASS_SPEC;
-            CR_RETURN_AST(decl_spec);
-        }
-        index(i);
-        if (auto type_spec = visit_type_specifier())
-        {
-            decl_spec->m_type_spec = type_spec;
-            decl_spec->m_type = AST_declaration_specifier::DS_TYPE_SPEC;
-            CR_RETURN_AST(decl_spec);
-        }
-        index(i);
-        if (auto type_qual = visit_type_qualifier())
-        {
-            decl_spec->m_type_qual = type_qual;
-            decl_spec->m_type = AST_declaration_specifier::DS_TYPE_QUAL;
-            CR_RETURN_AST(decl_spec);
-        }
-        index(i);
-        if (auto func_spec = visit_function_specifier())
+        switch (first_of_declaration_specifier())
         {
-            decl_spec->m_func_spec = func_spec;
-            decl_spec->m_type = AST_declaration_specifier::DS_FUNC_SPEC;
-            CR_RETURN_AST(decl_spec);
-        }
-        index(i);
-        if (auto align_spec = visit_alignment_specifier())
-        {
-            decl_spec->m_align_spec = align_spec;
-            decl_spec->m_type = AST_declaration_specifier::DS_ALIGN_SPEC;
-            CR_RETURN_AST(decl_spec);
+        case FIRST_STO_CLASS_SPEC:
+            if (auto sto_class_spec = visit_storage_class_specifier())
+            {
+                decl_spec->m_sto_class_spec = sto_class_spec;
+                decl_spec->m_type = AST_declaration_specifier::DS_STO_CLASS_SPEC;
+                CR_RETURN_AST(decl_spec);
+            }
+            break;
+        case FIRST_ATOMIC:
+            // '_Atomic', '(' is an atomic-type-specifier; otherwise a type-qualifier
+            if (auto type_spec = visit_type_specifier())
+            {
+                decl_spec->m_type_spec = type_spec;
+                decl_spec->m_type = AST_declaration_specifier::DS_TYPE_SPEC;
+                CR_RETURN_AST(decl_spec);
+            }
+            index(i);
+            // FALL THROUGH
+        case FIRST_TYPE_QUAL:
+            if (auto type_qual = visit_type_qualifier())
+            {
+                decl_spec->m_type_qual = type_qual;
+                decl_spec->m_type = AST_declaration_specifier::DS_TYPE_QUAL;
+                CR_RETURN_AST(decl_spec);
+            }
+            break;
+        case FIRST_TYPE_SPEC:
+            if (auto type_spec = visit_type_specifier())
+            {
+                decl_spec->m_type_spec = type_spec;
+                decl_spec->m_type = AST_declaration_specifier::DS_TYPE_SPEC;
+                CR_RETURN_AST(decl_spec);
+            }
+            break;
+        case FIRST_FUNC_SPEC:
+            if (auto func_spec = visit_function_specifier())
+            {
+                decl_spec->m_func_spec = func_spec;
+                decl_spec->m_type = AST_declaration_specifier::DS_FUNC_SPEC;
+                CR_RETURN_AST(decl_spec);
+            }
+            break;
+        case FIRST_ALIGN_SPEC:
+            if (auto align_spec = visit_alignment_specifier())
+            {
+                decl_spec->m_align_spec = align_spec;
+                decl_spec->m_type = AST_declaration_specifier::DS_ALIGN_SPEC;
+                CR_RETURN_AST(decl_spec);
+            }
+            break;
+        default:
+            break;
         }
         index(i);
         CR_RETURN_AST(nullptr);
     }
 
+    // FIRST(storage-class-specifier) = 'typedef' 'extern' 'static' '_Thread_local'
+    //                                  'auto' 'register' FIRST(attribute)
+    // FIRST(type-specifier) = 'void' 'char' 'short' 'int' 'long' 'float' 'double'
+    //                         'signed' 'unsigned' '_Bool' '_Complex' '_Imaginary'
+    //                         '__int64' '__float80' '__float128' '_Atomic'
+    //                         'struct' 'union' 'enum' typedef-name
+    // FIRST(type-qualifier) = 'const' 'restrict' 'volatile' '_Atomic' '__ptr64'
+    //                         '__restrict__'
+    // FIRST(function-specifier) = 'inline' '_Noreturn' '__inline' '__inline__'
+    //                             '__forceinline' FIRST(attribute)
+    // FIRST(alignment-specifier) = '_Alignas'
+    // FIRST(attribute) = '__declspec' '__attribute__'
+    // An attribute is always taken by storage-class-specifier, which is tried
+    // first in the grammar.
+    inline CParser::FirstOfDeclSpec CParser::first_of_declaration_specifier() const
+    {
+        switch (id())
+        {
+        case KW_TYPEDEF: case KW_EXTERN: case KW_STATIC: case KW__THREAD_LOCAL:
+        case KW_AUTO: case KW_REGISTER: case KW___DECLSPEC: case KW___ATTRIBUTE__:
+            return FIRST_STO_CLASS_SPEC;
+        case KW_VOID: case KW_CHAR: case KW_SHORT: case KW_INT: case KW_LONG:
+        case KW_FLOAT: case KW_DOUBLE: case KW_SIGNED: case KW_UNSIGNED:
+        case KW__BOOL: case KW__COMPLEX: case KW__IMAGINARY: case KW___INT64:
+        case KW___FLOAT80: case KW___FLOAT128: case KW_STRUCT: case KW_UNION:
+        case KW_ENUM:
+            return FIRST_TYPE_SPEC;
+        case KW__ATOMIC:
+            return FIRST_ATOMIC;
+        case KW_CONST: case KW_RESTRICT: case KW_VOLATILE: case KW___PTR64:
+        case KW___RESTRICT__:
+            return FIRST_TYPE_QUAL;
+        case KW_INLINE: case KW__NORETURN: case KW___INLINE: case KW___INLINE__:
+        case KW___FORCEINLINE:
+            return FIRST_FUNC_SPEC;
+        case KW__ALIGNAS:
+            return FIRST_ALIGN_SPEC;
+        case TID_NONE:
+            if (type() == TK_IDENTIFIER && m_names.is_typedef_name(str()))
+                return FIRST_TYPE_SPEC;
+            break;
+        default:
+            break;
+        }
+        return FIRST_NONE;
+    }
+
     // declarator = {function-attribute}, [pointer], {function-attribute}, direct-declarator;
     inline s_p<AST_declarator> CParser::visit_declarator()
+    {
+        return memoized(MEMO_DECLARATOR, &CParser::parse_declarator);
+    }
+    inline s_p<AST_declarator> CParser::parse_declarator()
     {
         CR_SHOW_STATUS();
-        auto declor = m_s<AST_declarator>();
+        auto declor = m_arena.make<AST_declarator>();
         auto i = index();
         while (scan_function_attribute(declor->m_attrs))
         {
@@ -703,7 +1847,7 @@ namespace CodeReverse
     inline s_p<AST_declaration_list> CParser::visit_declaration_list()
     {
         CR_SHOW_STATUS();
-        auto decl_list = m_s<AST_declaration_list>();
+        auto decl_list = m_arena.make<AST_declaration_list>();
         auto i = index();
         if (auto decl = visit_declaration())
         {
@@ -721,12 +1865,14 @@ namespace CodeReverse
     }
 
     // compound-statement = '{', {declaration-or-statement}, '}';
+    // NOTE: The names declared in the block go away at its end.
     inline s_p<AST_compound_statement> CParser::visit_compound_statement()
     {
         CR_SHOW_STATUS();
-        auto comp_stmt = m_s<AST_compound_statement>();
-        if (next_if("{"))
+        auto comp_stmt = m_arena.make<AST_compound_statement>();
+        if (next_if(SYM_L_BRACE))
         {
+            m_names.push_scope();
             auto i = index();
             while (auto decl_or_stmt = visit_declaration_or_statement())
             {
@@ -734,7 +1880,10 @@ namespace CodeReverse
                 i = index();
             }
             index(i);
-            if (next_if("}"))
+            bool closed = next_if(SYM_R_BRACE);
+            if (m_names.pop_scope())
+                names_changed();
+            if (closed)
             {
                 CR_RETURN_AST(comp_stmt);
             }
@@ -743,23 +1892,37 @@ namespace CodeReverse
     }
 
     // declaration-or-statement = declaration | statement;
+    // FIRST(declaration) = FIRST(declaration-specifier) '_Static_assert' ';'
     inline s_p<AST_declaration_or_statement> CParser::visit_declaration_or_statement()
     {
         CR_SHOW_STATUS();
-        auto decl_or_stmt = m_s<AST_declaration_or_statement>();
         auto i = index();
-        if (auto decl = visit_declaration())
+        auto names = m_names.checkpoint();
+        auto nodes = mark();
+        if (is(SYM_SEMICOLON) || is(KW__STATIC_ASSERT) ||
+            first_of_declaration_specifier() != FIRST_NONE)
         {
-            decl_or_stmt->m_decl = decl;
-            CR_RETURN_AST(decl_or_stmt);
+            if (auto decl = visit_declaration())
+            {
+                auto decl_or_stmt = m_arena.make<AST_declaration_or_statement>();
+                decl_or_stmt->m_decl = decl;
+                CR_RETURN_AST(decl_or_stmt);
+            }
+            index(i);
+            if (m_names.rollback(names))
+                names_changed();
+            give_back(nodes);
         }
-        index(i);
         if (auto stmt = visit_statement())
         {
+            auto decl_or_stmt = m_arena.make<AST_declaration_or_statement>();
             decl_or_stmt->m_stmt = stmt;
             CR_RETURN_AST(decl_or_stmt);
         }
         index(i);
+        if (m_names.rollback(names))
+            names_changed();
+        give_back(nodes);
         CR_RETURN_AST(nullptr);
     }
 
@@ -767,12 +1930,12 @@ namespace CodeReverse
     inline s_p<AST_init_declarator_list> CParser::visit_init_declarator_list()
     {
         CR_SHOW_STATUS();
-        auto init_declor_list = m_s<AST_init_declarator_list>();
+        auto init_declor_list = m_arena.make<AST_init_declarator_list>();
         auto i = index();
         if (auto init_declor = visit_init_declarator())
         {
             init_declor_list->push_back(init_declor);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
                 init_declor = visit_init_declarator();
                 if (!init_declor)
@@ -790,12 +1953,12 @@ namespace CodeReverse
     inline s_p<AST_init_declarator> CParser::visit_init_declarator()
     {
         CR_SHOW_STATUS();
-        auto init_declor = m_s<AST_init_declarator>();
+        auto init_declor = m_arena.make<AST_init_declarator>();
         auto i = index();
         if (auto declor = visit_declarator())
         {
             init_declor->m_declor = declor;
-            if (next_if("="))
+            if (next_if(SYM_ASSIGN))
             {
                 auto init = visit_initializer();
                 if (!init)
@@ -813,18 +1976,18 @@ namespace CodeReverse
     inline s_p<AST_static_assert_declaration> CParser::visit_static_assert_declaration()
     {
         CR_SHOW_STATUS();
-        auto static_assert_decl = m_s<AST_static_assert_declaration>();
-        if (next_if("_Static_assert") && next_if("("))
+        auto static_assert_decl = m_arena.make<AST_static_assert_declaration>();
+        if (next_if(KW__STATIC_ASSERT) && next_if(SYM_L_PAREN))
         {
             if (auto const_expr = visit_constant_expression())
             {
-                if (next_if(","))
+                if (next_if(SYM_COMMA))
                 {
                     if (type() == TK_STRING_LITERAL)
                     {
                         static_assert_decl->m_str = str();
                         next();
-                        if (next_if(")") && next_if(";"))
+                        if (next_if(SYM_R_PAREN) && next_if(SYM_SEMICOLON))
                         {
                             CR_RETURN_AST(static_assert_decl);
                         }
@@ -845,10 +2008,10 @@ namespace CodeReverse
     inline s_p<AST_storage_class_specifier> CParser::visit_storage_class_specifier()
     {
         CR_SHOW_STATUS();
-        auto sto_class_spec = m_s<AST_storage_class_specifier>();
-        if (str() == "typedef" || str() == "extern" ||
-            str() == "static" || str() == "_Thread_local" ||
-            str() == "auto" || str() == "register")
+        auto sto_class_spec = m_arena.make<AST_storage_class_specifier>();
+        if (is(KW_TYPEDEF) || is(KW_EXTERN) ||
+            is(KW_STATIC) || is(KW__THREAD_LOCAL) ||
+            is(KW_AUTO) || is(KW_REGISTER))
         {
             sto_class_spec->m_str = str();
             next();
@@ -883,12 +2046,12 @@ namespace CodeReverse
     inline s_p<AST_type_specifier> CParser::visit_type_specifier()
     {
         CR_SHOW_STATUS();
-        auto type_spec = m_s<AST_type_specifier>();
-        if (str() == "void" || str() == "char" || str() == "short" || 
-            str() == "int" || str() == "long" || str() == "float" || 
-            str() == "double" || str() == "signed" || str() == "unsigned" ||
-            str() == "_Bool" || str() == "_Complex" || str() == "_Imaginary" ||
-            str() == "__int64" || str() == "__float80" || str() == "__float128")
+        auto type_spec = m_arena.make<AST_type_specifier>();
+        if (is(KW_VOID) || is(KW_CHAR) || is(KW_SHORT) || 
+            is(KW_INT) || is(KW_LONG) || is(KW_FLOAT) || 
+            is(KW_DOUBLE) || is(KW_SIGNED) || is(KW_UNSIGNED) ||
+            is(KW__BOOL) || is(KW__COMPLEX) || is(KW__IMAGINARY) ||
+            is(KW___INT64) || is(KW___FLOAT80) || is(KW___FLOAT128))
         {
             type_spec->m_str = str();
             next();
@@ -917,7 +2080,7 @@ namespace CodeReverse
             CR_RETURN_AST(type_spec);
         }
         index(i);
-        if (type() == TK_IDENTIFIER && m_typedef_names.count(str()) > 0)
+        if (type() == TK_IDENTIFIER && m_names.is_typedef_name(str()))
         {
             type_spec->m_str = str();
             next();
@@ -937,16 +2100,16 @@ namespace CodeReverse
     inline s_p<AST_type_qualifier> CParser::visit_type_qualifier()
     {
         CR_SHOW_STATUS();
-        auto type_qual = m_s<AST_type_qualifier>();
-        if (str() == "const" || str() == "restrict" ||
-            str() == "volatile" || str() == "_Atomic" ||
-            str() == "__ptr64")
+        auto type_qual = m_arena.make<AST_type_qualifier>();
+        if (is(KW_CONST) || is(KW_RESTRICT) ||
+            is(KW_VOLATILE) || is(KW__ATOMIC) ||
+            is(KW___PTR64))
         {
             type_qual->m_str = str();
             next();
             CR_RETURN_AST(type_qual);
         }
-        if (next_if("__restrict__"))
+        if (next_if(KW___RESTRICT__))
         {
             type_qual->m_str = "restrict";
             CR_RETURN_AST(type_qual);
@@ -963,15 +2126,15 @@ namespace CodeReverse
     inline s_p<AST_function_specifier> CParser::visit_function_specifier()
     {
         CR_SHOW_STATUS();
-        auto func_spec = m_s<AST_function_specifier>();
-        if (str() == "inline" || str() == "_Noreturn")
+        auto func_spec = m_arena.make<AST_function_specifier>();
+        if (is(KW_INLINE) || is(KW__NORETURN))
         {
             func_spec->m_attrs[str()] = "";
             next();
             CR_RETURN_AST(func_spec);
         }
-        if (next_if("__inline") || next_if("__inline__") ||
-            next_if("__forceinline"))
+        if (next_if(KW___INLINE) || next_if(KW___INLINE__) ||
+            next_if(KW___FORCEINLINE))
         {
             func_spec->m_attrs["inline"] = "";
             CR_RETURN_AST(func_spec);
@@ -988,14 +2151,14 @@ namespace CodeReverse
     inline s_p<AST_alignment_specifier> CParser::visit_alignment_specifier()
     {
         CR_SHOW_STATUS();
-        auto align_spec = m_s<AST_alignment_specifier>();
-        if (next_if("_Alignas") && next_if("("))
+        auto align_spec = m_arena.make<AST_alignment_specifier>();
+        if (next_if(KW__ALIGNAS) && next_if(SYM_L_PAREN))
         {
             auto i = index();
             if (auto type_name = visit_type_name())
             {
                 align_spec->m_type_name = type_name;
-                if (next_if(")"))
+                if (next_if(SYM_R_PAREN))
                 {
                     CR_RETURN_AST(align_spec);
                 }
@@ -1004,7 +2167,7 @@ namespace CodeReverse
             if (auto const_expr = visit_constant_expression())
             {
                 align_spec->m_const_expr = const_expr;
-                if (next_if(")"))
+                if (next_if(SYM_R_PAREN))
                 {
                     CR_RETURN_AST(align_spec);
                 }
@@ -1018,8 +2181,8 @@ namespace CodeReverse
     inline s_p<AST_pointer> CParser::visit_pointer()
     {
         CR_SHOW_STATUS();
-        auto ptr = m_s<AST_pointer>();
-        if (next_if("*"))
+        auto ptr = m_arena.make<AST_pointer>();
+        if (next_if(SYM_STAR))
         {
             auto i = index();
             if (auto type_qual_list = visit_type_qualifier_list())
@@ -1052,15 +2215,16 @@ namespace CodeReverse
     inline s_p<AST_direct_declarator> CParser::visit_direct_declarator()
     {
         CR_SHOW_STATUS();
-        auto dir_declor = m_s<AST_direct_declarator>();
+        auto dir_declor = m_arena.make<AST_direct_declarator>();
         bool ok = false;
-        if (next_if("("))
+        auto i = index();
+        if (next_if(SYM_L_PAREN))
         {
             if (auto declor = visit_declarator())
             {
                 dir_declor->m_declor = declor;
                 dir_declor->m_type = AST_direct_declarator::DD_DECLOR;
-                ok = next_if(")");
+                ok = next_if(SYM_R_PAREN);
             }
         }
         else if (auto ident = visit_identifier(true))
@@ -1071,19 +2235,19 @@ namespace CodeReverse
         }
         if (ok)
         {
-            while (str() == "[" || str() == "(")
+            while (is(SYM_L_BRACKET) || is(SYM_L_PAREN))
             {
-                auto another = m_s<AST_direct_declarator>();
-                another->m_child = dir_declor;
+                auto another = m_arena.make<AST_direct_declarator>();
+                another->m_child = span(dir_declor, i);
                 dir_declor = another;
 
                 // '(', parameter-type-list, ')' |
                 // '(', identifier-list, ')' |
                 // '(', ')';
-                if (next_if("("))
+                if (next_if(SYM_L_PAREN))
                 {
                     another->m_type = AST_direct_declarator::DD_PAREN;
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         continue;
                     }
@@ -1091,37 +2255,37 @@ namespace CodeReverse
                     if (auto param_type_list = visit_parameter_type_list())
                     {
                         another->m_param_type_list = param_type_list;
-                        if (next_if(")"))
+                        if (next_if(SYM_R_PAREN))
                             continue;
                     }
                     index(i);
                     if (auto ident_list = visit_identifier_list())
                     {
-                        if (next_if(")"))
+                        if (next_if(SYM_R_PAREN))
                             continue;
                     }
                     index(i);
                     CR_RETURN_AST(nullptr);
                 }
-                else if (next_if("["))
+                else if (next_if(SYM_L_BRACKET))
                 {
                     another->m_type = AST_direct_declarator::DD_BRACKET;
                     // '[', ['*'], ']'
-                    if (next_if("]"))
+                    if (next_if(SYM_R_BRACKET))
                     {
                         continue;
                     }
-                    if (next_if("*"))
+                    if (next_if(SYM_STAR))
                     {
                         another->m_str = "*";
-                        if (next_if("]"))
+                        if (next_if(SYM_R_BRACKET))
                         {
                             continue;
                         }
                         CR_RETURN_AST(nullptr);
                     }
                     // '[', 'static', [type-qualifier-list], assignment-expression, ']'
-                    if (next_if("static"))
+                    if (next_if(KW_STATIC))
                     {
                         auto i = index();
                         if (auto type_qual_list = visit_type_qualifier_list())
@@ -1133,7 +2297,7 @@ namespace CodeReverse
                         if (auto assign_expr = visit_assignment_expression())
                         {
                             another->m_assign_expr = assign_expr;
-                            if (next_if("]"))
+                            if (next_if(SYM_R_BRACKET))
                             {
                                 continue;
                             }
@@ -1147,24 +2311,24 @@ namespace CodeReverse
                     if (auto type_qual_list = visit_type_qualifier_list())
                     {
                         another->m_type_qual_list = type_qual_list;
-                        if (next_if("*"))
+                        if (next_if(SYM_STAR))
                         {
                             another->m_str = "*";
-                            if (next_if("]"))
+                            if (next_if(SYM_R_BRACKET))
                             {
                                 continue;
                             }
                         }
                         else
                         {
-                            if (next_if("static"))
+                            if (next_if(KW_STATIC))
                             {
                                 another->m_str = "static";
                             }
                             if (auto assign_expr = visit_assignment_expression())
                             {
                                 another->m_assign_expr = assign_expr;
-                                if (next_if("]"))
+                                if (next_if(SYM_R_BRACKET))
                                 {
                                     continue;
                                 }
@@ -1177,7 +2341,7 @@ namespace CodeReverse
                     if (auto assign_expr = visit_assignment_expression())
                     {
                         another->m_assign_expr = assign_expr;
-                        if (next_if("]"))
+                        if (next_if(SYM_R_BRACKET))
                         {
                             continue;
                         }
@@ -1195,11 +2359,11 @@ namespace CodeReverse
     inline s_p<AST_identifier_list> CParser::visit_identifier_list()
     {
         CR_SHOW_STATUS();
-        auto ident_list = m_s<AST_identifier_list>();
+        auto ident_list = m_arena.make<AST_identifier_list>();
         if (auto ident = visit_identifier())
         {
             ident_list->push_back(ident);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
                 ident = visit_identifier();
                 if (!ident)
@@ -1215,10 +2379,10 @@ namespace CodeReverse
     inline s_p<AST_identifier> CParser::visit_identifier(bool tag)
     {
         CR_SHOW_STATUS();
-        auto ident = m_s<AST_identifier>();
+        auto ident = m_arena.make<AST_identifier>();
         if (type() == TK_IDENTIFIER)
         {
-            if (tag || m_typedef_names.count(str()) == 0)
+            if (tag || !m_names.is_typedef_name(str()))
             {
                 ident->m_str = str();
                 next();
@@ -1232,12 +2396,12 @@ namespace CodeReverse
     inline s_p<AST_initializer_list> CParser::visit_initializer_list()
     {
         CR_SHOW_STATUS();
-        auto init_list = m_s<AST_initializer_list>();
+        auto init_list = m_arena.make<AST_initializer_list>();
         auto i = index();
         if (auto design_init = visit_designative_initializer())
         {
             init_list->push_back(design_init);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
                 design_init = visit_designative_initializer();
                 if (!design_init)
@@ -1255,7 +2419,7 @@ namespace CodeReverse
     inline s_p<AST_designative_initializer> CParser::visit_designative_initializer()
     {
         CR_SHOW_STATUS();
-        auto design_init = m_s<AST_designative_initializer>();
+        auto design_init = m_arena.make<AST_designative_initializer>();
         auto i = index();
         if (auto design = visit_designation())
         {
@@ -1277,14 +2441,14 @@ namespace CodeReverse
     inline s_p<AST_initializer> CParser::visit_initializer()
     {
         CR_SHOW_STATUS();
-        auto init = m_s<AST_initializer>();
-        if (next_if("{"))
+        auto init = m_arena.make<AST_initializer>();
+        if (next_if(SYM_L_BRACE))
         {
             if (auto init_list = visit_initializer_list())
             {
                 init->m_init_list = init_list;
-                next_if(",");
-                if (next_if("}"))
+                next_if(SYM_COMMA);
+                if (next_if(SYM_R_BRACE))
                 {
                     CR_RETURN_AST(init);
                 }
@@ -1305,7 +2469,7 @@ namespace CodeReverse
     inline s_p<AST_constant_expression> CParser::visit_constant_expression()
     {
         CR_SHOW_STATUS();
-        auto const_expr = m_s<AST_constant_expression>();
+        auto const_expr = make_expr<AST_constant_expression>();
         auto i = index();
         if (auto cond_expr = visit_conditional_expression())
         {
@@ -1320,13 +2484,13 @@ namespace CodeReverse
     inline s_p<AST_atomic_type_specifier> CParser::visit_atomic_type_specifier()
     {
         CR_SHOW_STATUS();
-        auto atomic = m_s<AST_atomic_type_specifier>();
-        if (next_if("_Atomic") && next_if("("))
+        auto atomic = m_arena.make<AST_atomic_type_specifier>();
+        if (next_if(KW__ATOMIC) && next_if(SYM_L_PAREN))
         {
             if (auto type_name = visit_type_name())
             {
                 atomic->m_type_name = type_name;
-                if (next_if(")"))
+                if (next_if(SYM_R_PAREN))
                 {
                     CR_RETURN_AST(atomic);
                 }
@@ -1342,10 +2506,10 @@ namespace CodeReverse
     inline s_p<AST_struct_or_union_specifier> CParser::visit_struct_or_union_specifier()
     {
         CR_SHOW_STATUS();
-        auto su_spec = m_s<AST_struct_or_union_specifier>();
-        if (str() == "struct" || str() == "union")
+        auto su_spec = m_arena.make<AST_struct_or_union_specifier>();
+        if (is(KW_STRUCT) || is(KW_UNION))
         {
-            su_spec->m_is_union = (str() == "union");
+            su_spec->m_is_union = is(KW_UNION);
             next();
             auto i = index();
             while (scan_attribute(su_spec->m_attrs))
@@ -1359,12 +2523,12 @@ namespace CodeReverse
                 i = index();
             }
             index(i);
-            if (next_if("{"))
+            if (next_if(SYM_L_BRACE))
             {
                 if (auto struct_decl_list = visit_struct_declaration_list())
                 {
                     su_spec->m_struct_decl_list = struct_decl_list;
-                    if (next_if("}"))
+                    if (next_if(SYM_R_BRACE))
                     {
                         CR_RETURN_AST(su_spec);
                     }
@@ -1383,7 +2547,7 @@ namespace CodeReverse
     inline s_p<AST_struct_declaration_list> CParser::visit_struct_declaration_list()
     {
         CR_SHOW_STATUS();
-        auto struct_decl_list = m_s<AST_struct_declaration_list>();
+        auto struct_decl_list = m_arena.make<AST_struct_declaration_list>();
         auto i = index();
         if (auto struct_decl = visit_struct_declaration())
         {
@@ -1407,8 +2571,8 @@ namespace CodeReverse
     inline s_p<AST_struct_declaration> CParser::visit_struct_declaration()
     {
         CR_SHOW_STATUS();
-        auto struct_decl = m_s<AST_struct_declaration>();
-        if (next_if(";"))
+        auto struct_decl = m_arena.make<AST_struct_declaration>();
+        if (next_if(SYM_SEMICOLON))
         {
             CR_RETURN_AST(struct_decl);
         }
@@ -1416,7 +2580,7 @@ namespace CodeReverse
         if (auto spec_qual_list = visit_specifier_qualifier_list())
         {
             struct_decl->m_spec_qual_list = spec_qual_list;
-            if (next_if(";"))
+            if (next_if(SYM_SEMICOLON))
             {
                 CR_RETURN_AST(struct_decl);
             }
@@ -1429,7 +2593,7 @@ namespace CodeReverse
                     i = index();
                 }
                 index(i);
-                if (next_if(";"))
+                if (next_if(SYM_SEMICOLON))
                 {
                     CR_RETURN_AST(struct_decl);
                 }
@@ -1451,8 +2615,8 @@ namespace CodeReverse
     inline s_p<AST_enum_specifier> CParser::visit_enum_specifier()
     {
         CR_SHOW_STATUS();
-        auto enum_spec = m_s<AST_enum_specifier>();
-        if (next_if("enum"))
+        auto enum_spec = m_arena.make<AST_enum_specifier>();
+        if (next_if(KW_ENUM))
         {
             if (auto ident = visit_identifier(true))
             {
@@ -1460,18 +2624,18 @@ namespace CodeReverse
             }
             else
             {
-                if (str() != "{")
+                if (!is(SYM_L_BRACE))
                 {
                     CR_RETURN_AST(nullptr);
                 }
             }
-            if (next_if("{"))
+            if (next_if(SYM_L_BRACE))
             {
                 if (auto enum_list = visit_enumerator_list())
                 {
                     enum_spec->m_enum_list = enum_list;
-                    next_if(",");
-                    if (next_if("}"))
+                    next_if(SYM_COMMA);
+                    if (next_if(SYM_R_BRACE))
                     {
                         CR_RETURN_AST(enum_spec);
                     }
@@ -1489,13 +2653,13 @@ namespace CodeReverse
     inline s_p<AST_enumerator_list> CParser::visit_enumerator_list()
     {
         CR_SHOW_STATUS();
-        auto enum_list = m_s<AST_enumerator_list>();
+        auto enum_list = m_arena.make<AST_enumerator_list>();
         if (auto enumor = visit_enumerator())
         {
             enum_list->push_back(enumor);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
-                if (str() == "}")
+                if (is(SYM_R_BRACE))
                 {
                     prev();
                     break;
@@ -1516,12 +2680,13 @@ namespace CodeReverse
     inline s_p<AST_enumerator> CParser::visit_enumerator()
     {
         CR_SHOW_STATUS();
-        auto enumor = m_s<AST_enumerator>();
+        auto enumor = m_arena.make<AST_enumerator>();
         if (auto ident = visit_identifier())
         {
-            m_enum_constant_names.insert(ident->m_str);
+            if (m_names.add(ident->m_str, NameTable::ENUM_CONSTANT))
+                names_changed();
             enumor->m_ident = ident;
-            if (next_if("="))
+            if (next_if(SYM_ASSIGN))
             {
                 if (auto const_expr = visit_constant_expression())
                 {
@@ -1537,9 +2702,13 @@ namespace CodeReverse
 
     // type-name = specifier-qualifier-list, [abstract-declarator];
     inline s_p<AST_type_name> CParser::visit_type_name()
+    {
+        return memoized(MEMO_TYPE_NAME, &CParser::parse_type_name);
+    }
+    inline s_p<AST_type_name> CParser::parse_type_name()
     {
         CR_SHOW_STATUS();
-        auto type_name = m_s<AST_type_name>();
+        auto type_name = m_arena.make<AST_type_name>();
         auto i = index();
         if (auto spec_qual_list = visit_specifier_qualifier_list())
         {
@@ -1561,7 +2730,7 @@ namespace CodeReverse
     inline s_p<AST_specifier_qualifier_list> CParser::visit_specifier_qualifier_list()
     {
         CR_SHOW_STATUS();
-        auto spec_qual_list = m_s<AST_specifier_qualifier_list>();
+        auto spec_qual_list = m_arena.make<AST_specifier_qualifier_list>();
         if (auto spec_qual = visit_specifier_qualifier())
         {
             auto i = index();
@@ -1581,7 +2750,7 @@ namespace CodeReverse
     inline s_p<AST_specifier_qualifier> CParser::visit_specifier_qualifier()
     {
         CR_SHOW_STATUS();
-        auto spec_qual = m_s<AST_specifier_qualifier>();
+        auto spec_qual = m_arena.make<AST_specifier_qualifier>();
         auto i = index();
         if (auto type_spec = visit_type_specifier())
         {
@@ -1603,7 +2772,7 @@ namespace CodeReverse
     inline s_p<AST_abstract_declarator> CParser::visit_abstract_declarator()
     {
         CR_SHOW_STATUS();
-        auto abst_declor = m_s<AST_abstract_declarator>();
+        auto abst_declor = m_arena.make<AST_abstract_declarator>();
         auto i = index();
         while (scan_function_attribute(abst_declor->m_attrs))
         {
@@ -1653,12 +2822,12 @@ namespace CodeReverse
     inline s_p<AST_direct_abstract_declarator> CParser::visit_direct_abstract_declarator()
     {
         CR_SHOW_STATUS();
-        auto dir_abst_declor = m_s<AST_direct_abstract_declarator>();
+        auto dir_abst_declor = m_arena.make<AST_direct_abstract_declarator>();
         bool ok = false;
-        if (next_if("("))
+        if (next_if(SYM_L_PAREN))
         {
             auto i = index();
-            if (next_if(")"))
+            if (next_if(SYM_R_PAREN))
             {
                 // '(', ')', ...
                 ok = true;
@@ -1667,7 +2836,7 @@ namespace CodeReverse
             {
                 // '(', parameter-type-list, ')', ...
                 dir_abst_declor->m_param_type_list = param_type_list;
-                ok = next_if(")");
+                ok = next_if(SYM_R_PAREN);
             }
             else
             {
@@ -1676,23 +2845,23 @@ namespace CodeReverse
                 if (auto abst_declor = visit_abstract_declarator())
                 {
                     dir_abst_declor->m_abst_declor = abst_declor;
-                    ok = next_if(")");
+                    ok = next_if(SYM_R_PAREN);
                 }
             }
         }
-        else if (next_if("["))
+        else if (next_if(SYM_L_BRACKET))
         {
             // '[', ['*'], ']', ...
-            if (next_if("]"))
+            if (next_if(SYM_R_BRACKET))
             {
                 ok = true;
             }
-            else if (next_if("*"))
+            else if (next_if(SYM_STAR))
             {
                 dir_abst_declor->m_str = "*";
-                ok = next_if("]");
+                ok = next_if(SYM_R_BRACKET);
             }
-            else if (next_if("static"))
+            else if (next_if(KW_STATIC))
             {
                 // '[', 'static', [type-qualifier-list], assignment-expression, ']', ...
                 auto i = index();
@@ -1705,7 +2874,7 @@ namespace CodeReverse
                 if (auto assign_expr = visit_assignment_expression())
                 {
                     dir_abst_declor->m_assign_expr = assign_expr;
-                    ok = next_if("]");
+                    ok = next_if(SYM_R_BRACKET);
                 }
             }
             else
@@ -1715,23 +2884,23 @@ namespace CodeReverse
                 if (auto type_qual_list = visit_type_qualifier_list())
                 {
                     dir_abst_declor->m_type_qual_list = type_qual_list;
-                    if (next_if("]"))
+                    if (next_if(SYM_R_BRACKET))
                     {
                         ok = true;
                     }
-                    else if (next_if("static"))
+                    else if (next_if(KW_STATIC))
                     {
                         dir_abst_declor->m_str = "static";
                         if (auto assign_expr = visit_assignment_expression())
                         {
                             dir_abst_declor->m_assign_expr = assign_expr;
-                            ok = next_if("]");
+                            ok = next_if(SYM_R_BRACKET);
                         }
                     }
                     else if (auto assign_expr = visit_assignment_expression())
                     {
                         dir_abst_declor->m_assign_expr = assign_expr;
-                        ok = next_if("]");
+                        ok = next_if(SYM_R_BRACKET);
                     }
                 }
                 else
@@ -1741,22 +2910,22 @@ namespace CodeReverse
                     if (auto assign_expr = visit_assignment_expression())
                     {
                         dir_abst_declor->m_assign_expr = assign_expr;
-                        ok = next_if("]");
+                        ok = next_if(SYM_R_BRACKET);
                     }
                 }
             }
         }
         if (ok)
         {
-            while (str() == "(" || str() == "[")
+            while (is(SYM_L_PAREN) || is(SYM_L_BRACKET))
             {
-                auto another = m_s<AST_direct_abstract_declarator>();
-                another->m_child = dir_abst_declor;
+                auto another = m_arena.make<AST_direct_abstract_declarator>();
+                another->m_child = span(dir_abst_declor, cr_first);
                 dir_abst_declor = another;
 
-                if (next_if("("))
+                if (next_if(SYM_L_PAREN))
                 {
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         // '(', ')';
                         continue;
@@ -1765,28 +2934,28 @@ namespace CodeReverse
                     {
                         // '(', parameter-type-list, ')'
                         another->m_param_type_list = param_type_list;
-                        if (next_if(")"))
+                        if (next_if(SYM_R_PAREN))
                         {
                             continue;
                         }
                     }
                 }
-                else if (next_if("["))
+                else if (next_if(SYM_L_BRACKET))
                 {
                     // '[', ['*'], ']'
-                    if (next_if("]"))
+                    if (next_if(SYM_R_BRACKET))
                     {
                         continue;
                     }
-                    else if (next_if("*"))
+                    else if (next_if(SYM_STAR))
                     {
                         another->m_str = "*";
-                        if (next_if("]"))
+                        if (next_if(SYM_R_BRACKET))
                         {
                             continue;
                         }
                     }
-                    else if (next_if("static"))
+                    else if (next_if(KW_STATIC))
                     {
                         // '[', 'static', [type-qualifier-list], assignment-expression, ']'
                         another->m_str = "static";
@@ -1800,7 +2969,7 @@ namespace CodeReverse
                         if (auto assign_expr = visit_assignment_expression())
                         {
                             another->m_assign_expr = assign_expr;
-                            if (next_if("]"))
+                            if (next_if(SYM_R_BRACKET))
                             {
                                 continue;
                             }
@@ -1813,20 +2982,20 @@ namespace CodeReverse
                         if (auto type_qual_list = visit_type_qualifier_list())
                         {
                             another->m_type_qual_list = type_qual_list;
-                            if (next_if("]"))
+                            if (next_if(SYM_R_BRACKET))
                             {
                                 continue;
                             }
                             else
                             {
-                                if (next_if("static"))
+                                if (next_if(KW_STATIC))
                                 {
                                     another->m_str = "static";
                                 }
                                 if (auto assign_expr = visit_assignment_expression())
                                 {
                                     another->m_assign_expr = assign_expr;
-                                    if (next_if("]"))
+                                    if (next_if(SYM_R_BRACKET))
                                     {
                                         continue;
                                     }
@@ -1838,7 +3007,7 @@ namespace CodeReverse
                         if (auto assign_expr = visit_assignment_expression())
                         {
                             another->m_assign_expr = assign_expr;
-                            if (next_if("]"))
+                            if (next_if(SYM_R_BRACKET))
                             {
                                 continue;
                             }
@@ -1856,11 +3025,11 @@ namespace CodeReverse
     inline s_p<AST_struct_declarator_list> CParser::visit_struct_declarator_list()
     {
         CR_SHOW_STATUS();
-        auto struct_declor_list = m_s<AST_struct_declarator_list>();
+        auto struct_declor_list = m_arena.make<AST_struct_declarator_list>();
         if (auto struct_declor = visit_struct_declarator())
         {
             struct_declor_list->push_back(struct_declor);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
                 struct_declor = visit_struct_declarator();
                 if (!struct_declor)
@@ -1877,7 +3046,7 @@ namespace CodeReverse
     inline s_p<AST_type_qualifier_list> CParser::visit_type_qualifier_list()
     {
         CR_SHOW_STATUS();
-        auto type_qual_list = m_s<AST_type_qualifier_list>();
+        auto type_qual_list = m_arena.make<AST_type_qualifier_list>();
         if (auto type_qual = visit_type_qualifier())
         {
             auto i = index();
@@ -1897,14 +3066,14 @@ namespace CodeReverse
     inline s_p<AST_parameter_type_list> CParser::visit_parameter_type_list()
     {
         CR_SHOW_STATUS();
-        auto param_type_list = m_s<AST_parameter_type_list>();
+        auto param_type_list = m_arena.make<AST_parameter_type_list>();
         param_type_list->m_has_dots = false;
         if (auto param_list = visit_parameter_list())
         {
             param_type_list->m_param_list = param_list;
-            if (next_if(","))
+            if (next_if(SYM_COMMA))
             {
-                if (next_if("..."))
+                if (next_if(SYM_ELLIPSIS))
                 {
                     param_type_list->m_has_dots = true;
                     CR_RETURN_AST(param_type_list);
@@ -1921,8 +3090,8 @@ namespace CodeReverse
     inline s_p<AST_struct_declarator> CParser::visit_struct_declarator()
     {
         CR_SHOW_STATUS();
-        auto struct_declor = m_s<AST_struct_declarator>();
-        if (next_if(":"))
+        auto struct_declor = m_arena.make<AST_struct_declarator>();
+        if (next_if(SYM_COLON))
         {
             if (auto const_expr = visit_constant_expression())
             {
@@ -1935,7 +3104,7 @@ namespace CodeReverse
         if (auto declor = visit_declarator())
         {
             struct_declor->m_declor = declor;
-            if (next_if(":"))
+            if (next_if(SYM_COLON))
             {
                 if (auto const_expr = visit_constant_expression())
                 {
@@ -1954,13 +3123,13 @@ namespace CodeReverse
     inline s_p<AST_parameter_list> CParser::visit_parameter_list()
     {
         CR_SHOW_STATUS();
-        auto param_list = m_s<AST_parameter_list>();
+        auto param_list = m_arena.make<AST_parameter_list>();
         if (auto param_decl = visit_parameter_declaration())
         {
             param_list->push_back(param_decl);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
-                if (str() == "...")
+                if (is(SYM_ELLIPSIS))
                 {
                     prev();
                     break;
@@ -1980,7 +3149,7 @@ namespace CodeReverse
     inline s_p<AST_parameter_declaration> CParser::visit_parameter_declaration()
     {
         CR_SHOW_STATUS();
-        auto param_decl = m_s<AST_parameter_declaration>();
+        auto param_decl = m_arena.make<AST_parameter_declaration>();
         if (auto decl_specs = visit_declaration_specifiers())
         {
             param_decl->m_decl_specs = decl_specs;
@@ -2006,12 +3175,12 @@ namespace CodeReverse
     inline s_p<AST_expression> CParser::visit_expression()
     {
         CR_SHOW_STATUS();
-        auto expr = m_s<AST_expression>();
+        auto expr = make_expr<AST_expression>();
         auto i = index();
         if (auto assign_expr = visit_assignment_expression())
         {
             expr->push_back(assign_expr);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
                 assign_expr = visit_assignment_expression();
                 if (!assign_expr)
@@ -2038,30 +3207,39 @@ namespace CodeReverse
     //                     | '&=' 
     //                     | '^=' 
     //                     | '|=';
+    // NOTE: The first operand is parsed only once, as a cast-expression.
+    //       If it is a unary-expression followed by an assignment-operator,
+    //       it is the left side of an assignment; otherwise it starts the
+    //       conditional-expression.
     inline s_p<AST_assignment_expression> CParser::visit_assignment_expression()
     {
         CR_SHOW_STATUS();
-        auto assign_expr = m_s<AST_assignment_expression>();
+        auto assign_expr = make_expr<AST_assignment_expression>();
         auto i = index();
-        if (auto unary_expr = visit_unary_expression())
+        auto cast_expr = visit_cast_expression();
+        if (!cast_expr)
+        {
+            index(i);
+            CR_RETURN_AST(nullptr);
+        }
+        if (cast_expr->m_unary_expr &&
+            (is(SYM_ASSIGN) || is(SYM_MUL_ASSIGN) || is(SYM_DIV_ASSIGN) ||
+             is(SYM_MOD_ASSIGN) || is(SYM_ADD_ASSIGN) || is(SYM_SUB_ASSIGN) ||
+             is(SYM_SHL_ASSIGN) || is(SYM_SHR_ASSIGN) || is(SYM_AND_ASSIGN) ||
+             is(SYM_XOR_ASSIGN) || is(SYM_OR_ASSIGN)))
         {
-            if (str() == "=" || str() == "*=" || str() == "/=" ||
-                str() == "%=" || str() == "+=" || str() == "-=" ||
-                str() == "<<=" || str() == ">>=" || str() == "&=" ||
-                str() == "^=" || str() == "|=")
+            auto j = index();
+            next();
+            if (auto another = visit_assignment_expression())
             {
-                assign_expr->m_assign_op = str();
-                next();
-                if (auto another = visit_assignment_expression())
-                {
-                    assign_expr->m_unary_expr = unary_expr;
-                    assign_expr->m_child = another;
-                    CR_RETURN_AST(assign_expr);
-                }
+                assign_expr->m_unary_expr = cast_expr->m_unary_expr;
+                assign_expr->m_assign_op = m_lexer.tokens().id(j);
+                assign_expr->m_child = another;
+                CR_RETURN_AST(assign_expr);
             }
+            index(j);
         }
-        index(i);
-        if (auto cond_expr = visit_conditional_expression())
+        if (auto cond_expr = visit_conditional_expression(cast_expr))
         {
             assign_expr->m_cond_expr = cond_expr;
             CR_RETURN_AST(assign_expr);
@@ -2074,295 +3252,299 @@ namespace CodeReverse
     inline s_p<AST_conditional_expression> CParser::visit_conditional_expression()
     {
         CR_SHOW_STATUS();
-        auto cond_expr = m_s<AST_conditional_expression>();
         auto i = index();
-        if (auto log_or_expr = visit_logical_or_expression())
+        if (auto cast_expr = visit_cast_expression())
+        {
+            if (auto cond_expr = visit_conditional_expression(cast_expr))
+                CR_RETURN_AST(cond_expr);
+        }
+        index(i);
+        CR_RETURN_AST(nullptr);
+    }
+    inline s_p<AST_conditional_expression>
+    CParser::visit_conditional_expression(s_p<AST_cast_expression> first)
+    {
+        CR_SHOW_STATUS();
+        auto cond_expr = make_expr<AST_conditional_expression>();
+        if (auto log_or_expr = visit_logical_or_expression(first))
         {
             cond_expr->m_log_or_expr = log_or_expr;
-            if (next_if("?"))
+            if (next_if(SYM_QUESTION))
             {
                 if (auto expr = visit_expression())
                 {
                     cond_expr->m_expr = expr;
-                    if (next_if(":"))
+                    if (next_if(SYM_COLON))
                     {
                         if (auto another = visit_conditional_expression())
                         {
                             cond_expr->m_child = another;
-                            CR_RETURN_AST(cond_expr);
+                            CR_RETURN_AST(span(cond_expr, first->m_first));
                         }
                     }
                 }
                 CR_RETURN_AST(nullptr);
             }
-            CR_RETURN_AST(cond_expr);
+            CR_RETURN_AST(span(cond_expr, first->m_first));
         }
-        index(i);
         CR_RETURN_AST(nullptr);
     }
 
     // logical-or-expression = logical-and-expression, {'||', logical-and-expression};
-    inline s_p<AST_logical_or_expression> CParser::visit_logical_or_expression()
-    {
-        CR_SHOW_STATUS();
-        auto log_or_expr = m_s<AST_logical_or_expression>();
-        auto i = index();
-        if (auto log_and_expr = visit_logical_and_expression())
-        {
-            log_or_expr->push_back(log_and_expr);
-            while (next_if("||"))
-            {
-                log_and_expr = visit_logical_and_expression();
-                if (!log_and_expr)
-                    CR_RETURN_AST(nullptr);
-
-                log_or_expr->push_back(log_and_expr);
-            }
-            CR_RETURN_AST(log_or_expr);
-        }
-        index(i);
-        CR_RETURN_AST(nullptr);
-    }
-
     // logical-and-expression = inclusive-or-expression, {'&&', inclusive-or-expression};
-    inline s_p<AST_logical_and_expression> CParser::visit_logical_and_expression()
+    // inclusive-or-expression = exclusive-or-expression, {'|', exclusive-or-expression};
+    // exclusive-or-expression = and-expression, {'^', and-expression};
+    // and-expression = equality-expression, {'&', equality-expression};
+    // equality-expression = relational-expression, {('==' | '!='), relational-expression};
+    // relational-expression = shift-expression, {('<' | '>' | '<=' | '>='), shift-expression};
+    // shift-expression = additive-expression, {('<<' | '>>'), additive-expression};
+    // additive-expression = multiplicative-expression, {('+' | '-'), multiplicative-expression};
+    // multiplicative-expression = cast-expression, {('*' | '/' | '%'), cast-expression};
+    // NOTE: These ten rules are parsed by precedence climbing in one loop
+    //       over the cast-expressions. The nodes are the same as if each
+    //       rule had been visited in turn.
+    inline s_p<AST_logical_or_expression>
+    CParser::visit_logical_or_expression(s_p<AST_cast_expression> first)
     {
         CR_SHOW_STATUS();
-        auto log_and_expr = m_s<AST_logical_and_expression>();
-        auto i = index();
-        if (auto incl_or_expr = visit_inclusive_or_expression())
+        // The operator levels go up strictly along the stack, so the stack
+        // is never deeper than the number of levels. ops[k] is the operator
+        // between operands[k] and operands[k + 1].
+        s_p<AST_base> operands[BL_CAST];
+        int operand_levels[BL_CAST];
+        TokenID ops[BL_MULTIPLICATIVE];
+        int op_levels[BL_MULTIPLICATIVE];
+        size_t count = 0;
+        operands[0] = first;
+        operand_levels[0] = BL_CAST;
+        for (;;)
         {
-            log_and_expr->push_back(incl_or_expr);
-            while (next_if("&&"))
+            int level = binary_level(id());
+            while (count > 0 && op_levels[count - 1] >= level)
             {
-                incl_or_expr = visit_inclusive_or_expression();
-                if (!incl_or_expr)
-                    CR_RETURN_AST(nullptr);
-
-                log_and_expr->push_back(incl_or_expr);
+                --count;
+                int op_level = op_levels[count];
+                auto left = lift_binary(operands[count], operand_levels[count], op_level);
+                auto right = lift_binary(operands[count + 1], operand_levels[count + 1], op_level + 1);
+                operands[count] = join_binary(op_level, left, ops[count], right);
+                operands[count]->m_first = left->m_first;
+                operands[count]->m_last = right->m_last;
+                operand_levels[count] = op_level;
+                operands[count + 1].reset();
             }
-            CR_RETURN_AST(log_and_expr);
-        }
-        index(i);
-        CR_RETURN_AST(nullptr);
-    }
+            if (level == BL_NONE)
+                break;
 
-    // inclusive-or-expression = exclusive-or-expression, {'|', exclusive-or-expression};
-    inline s_p<AST_inclusive_or_expression> CParser::visit_inclusive_or_expression()
-    {
-        CR_SHOW_STATUS();
-        auto incl_or_expr = m_s<AST_inclusive_or_expression>();
-        auto i = index();
-        if (auto excl_or_expr = visit_exclusive_or_expression())
-        {
-            incl_or_expr->push_back(excl_or_expr);
-            while (next_if("|"))
-            {
-                excl_or_expr = visit_exclusive_or_expression();
-                if (!excl_or_expr)
-                    CR_RETURN_AST(nullptr);
+            ops[count] = id();
+            op_levels[count] = level;
+            next();
 
-                incl_or_expr->push_back(excl_or_expr);
-            }
-            CR_RETURN_AST(incl_or_expr);
+            auto cast_expr = visit_cast_expression();
+            if (!cast_expr)
+                CR_RETURN_AST(nullptr);
+
+            ++count;
+            operands[count] = cast_expr;
+            operand_levels[count] = BL_CAST;
         }
-        index(i);
-        CR_RETURN_AST(nullptr);
+        auto node = lift_binary(operands[0], operand_levels[0], BL_LOGICAL_OR);
+        CR_RETURN_AST(static_pointer_cast<AST_logical_or_expression>(node));
     }
 
-    // exclusive-or-expression = and-expression, {'^', and-expression};
-    inline s_p<AST_exclusive_or_expression> CParser::visit_exclusive_or_expression()
+    inline int CParser::binary_level(TokenID id)
     {
-        CR_SHOW_STATUS();
-        auto excl_or_expr = m_s<AST_exclusive_or_expression>();
-        auto i = index();
-        if (auto and_expr = visit_and_expression())
-        {
-            excl_or_expr->push_back(and_expr);
-            while (next_if("^"))
-            {
-                and_expr = visit_and_expression();
-                if (!and_expr)
-                    CR_RETURN_AST(nullptr);
-
-                excl_or_expr->push_back(and_expr);
-            }
-            CR_RETURN_AST(excl_or_expr);
+        switch (id)
+        {
+        case SYM_OR_OR:
+            return BL_LOGICAL_OR;
+        case SYM_AND_AND:
+            return BL_LOGICAL_AND;
+        case SYM_BAR:
+            return BL_INCLUSIVE_OR;
+        case SYM_CARET:
+            return BL_EXCLUSIVE_OR;
+        case SYM_AMP:
+            return BL_AND;
+        case SYM_EQ: case SYM_NE:
+            return BL_EQUALITY;
+        case SYM_LT: case SYM_GT: case SYM_LE: case SYM_GE:
+            return BL_RELATIONAL;
+        case SYM_SHL: case SYM_SHR:
+            return BL_SHIFT;
+        case SYM_PLUS: case SYM_MINUS:
+            return BL_ADDITIVE;
+        case SYM_STAR: case SYM_SLASH: case SYM_PERCENT:
+            return BL_MULTIPLICATIVE;
+        default:
+            return BL_NONE;
         }
-        index(i);
-        CR_RETURN_AST(nullptr);
     }
 
-    // and-expression = equality-expression, {'&', equality-expression};
-    inline s_p<AST_and_expression> CParser::visit_and_expression()
+    // wraps a node of level 'from' into the nodes of the lower levels down to 'to'
+    inline s_p<AST_base> CParser::lift_binary(s_p<AST_base> node, int from, int to)
     {
-        CR_SHOW_STATUS();
-        auto and_expr = m_s<AST_and_expression>();
-        auto i = index();
-        if (auto equal_expr = visit_equality_expression())
+        const unsigned int first = node->m_first, last = node->m_last;
+        while (from > to)
         {
-            and_expr->push_back(equal_expr);
-            while (next_if("&"))
+            --from;
+            switch (from)
             {
-                equal_expr = visit_equality_expression();
-                if (!equal_expr)
-                    CR_RETURN_AST(nullptr);
-
-                and_expr->push_back(equal_expr);
+            case BL_LOGICAL_OR:
+                {
+                    auto expr = make_expr<AST_logical_or_expression>();
+                    expr->push_back(static_pointer_cast<AST_logical_and_expression>(node));
+                    node = expr;
+                }
+                break;
+            case BL_LOGICAL_AND:
+                {
+                    auto expr = make_expr<AST_logical_and_expression>();
+                    expr->push_back(static_pointer_cast<AST_inclusive_or_expression>(node));
+                    node = expr;
+                }
+                break;
+            case BL_INCLUSIVE_OR:
+                {
+                    auto expr = make_expr<AST_inclusive_or_expression>();
+                    expr->push_back(static_pointer_cast<AST_exclusive_or_expression>(node));
+                    node = expr;
+                }
+                break;
+            case BL_EXCLUSIVE_OR:
+                {
+                    auto expr = make_expr<AST_exclusive_or_expression>();
+                    expr->push_back(static_pointer_cast<AST_and_expression>(node));
+                    node = expr;
+                }
+                break;
+            case BL_AND:
+                {
+                    auto expr = make_expr<AST_and_expression>();
+                    expr->push_back(static_pointer_cast<AST_equality_expression>(node));
+                    node = expr;
+                }
+                break;
+            case BL_EQUALITY:
+                {
+                    auto expr = make_expr<AST_equality_expression>();
+                    expr->m_rel_expr = static_pointer_cast<AST_relational_expression>(node);
+                    node = expr;
+                }
+                break;
+            case BL_RELATIONAL:
+                {
+                    auto expr = make_expr<AST_relational_expression>();
+                    expr->m_shift_expr = static_pointer_cast<AST_shift_expression>(node);
+                    node = expr;
+                }
+                break;
+            case BL_SHIFT:
+                {
+                    auto expr = make_expr<AST_shift_expression>();
+                    expr->m_add_expr = static_pointer_cast<AST_additive_expression>(node);
+                    node = expr;
+                }
+                break;
+            case BL_ADDITIVE:
+                {
+                    auto expr = make_expr<AST_additive_expression>();
+                    expr->m_mul_expr = static_pointer_cast<AST_multiplicative_expression>(node);
+                    node = expr;
+                }
+                break;
+            case BL_MULTIPLICATIVE:
+                {
+                    auto expr = make_expr<AST_multiplicative_expression>();
+                    expr->m_cast_expr = static_pointer_cast<AST_cast_expression>(node);
+                    node = expr;
+                }
+                break;
+            default:
+                assert(0);
+                break;
             }
-            CR_RETURN_AST(and_expr);
+            node->m_first = first;
+            node->m_last = last;
         }
-        index(i);
-        CR_RETURN_AST(nullptr);
+        return node;
     }
 
-    // equality-expression = relational-expression, {('==' | '!='), relational-expression};
-    inline s_p<AST_equality_expression> CParser::visit_equality_expression()
+    // joins 'left' of level 'level' and 'right' of the next level by 'op'
+    inline s_p<AST_base>
+    CParser::join_binary(int level, s_p<AST_base> left, TokenID op,
+                         s_p<AST_base> right)
     {
-        CR_SHOW_STATUS();
-        auto equal_expr = m_s<AST_equality_expression>();
-        auto i = index();
-        if (auto rel_expr = visit_relational_expression())
-        {
-            equal_expr->m_rel_expr = rel_expr;
-            while (str() == "==" || str() == "!=")
+        switch (level)
+        {
+        case BL_LOGICAL_OR:
+            static_pointer_cast<AST_logical_or_expression>(left)->push_back(
+                static_pointer_cast<AST_logical_and_expression>(right));
+            return left;
+        case BL_LOGICAL_AND:
+            static_pointer_cast<AST_logical_and_expression>(left)->push_back(
+                static_pointer_cast<AST_inclusive_or_expression>(right));
+            return left;
+        case BL_INCLUSIVE_OR:
+            static_pointer_cast<AST_inclusive_or_expression>(left)->push_back(
+                static_pointer_cast<AST_exclusive_or_expression>(right));
+            return left;
+        case BL_EXCLUSIVE_OR:
+            static_pointer_cast<AST_exclusive_or_expression>(left)->push_back(
+                static_pointer_cast<AST_and_expression>(right));
+            return left;
+        case BL_AND:
+            static_pointer_cast<AST_and_expression>(left)->push_back(
+                static_pointer_cast<AST_equality_expression>(right));
+            return left;
+        case BL_EQUALITY:
             {
-                equal_expr->m_op = str();
-                next();
-
-                rel_expr = visit_relational_expression();
-                if (!rel_expr)
-                    CR_RETURN_AST(nullptr);
-
-                auto another = m_s<AST_equality_expression>();
-                another->m_child = equal_expr;
-                another->m_rel_expr = rel_expr;
-
-                equal_expr = another;
+                auto child = static_pointer_cast<AST_equality_expression>(left);
+                child->m_op = op;
+                auto expr = make_expr<AST_equality_expression>();
+                expr->m_child = child;
+                expr->m_rel_expr = static_pointer_cast<AST_relational_expression>(right);
+                return expr;
             }
-            CR_RETURN_AST(equal_expr);
-        }
-        index(i);
-        CR_RETURN_AST(nullptr);
-    }
-
-    // relational-expression = shift-expression, {('<' | '>' | '<=' | '>='), shift-expression};
-    inline s_p<AST_relational_expression> CParser::visit_relational_expression()
-    {
-        CR_SHOW_STATUS();
-        auto rel_expr = m_s<AST_relational_expression>();
-        auto i = index();
-        if (auto shift_expr = visit_shift_expression())
-        {
-            rel_expr->m_shift_expr = shift_expr;
-            while (str() == "<" || str() == ">" ||
-                   str() == "<=" || str() == ">=")
+        case BL_RELATIONAL:
             {
-                rel_expr->m_op = str();
-                next();
-
-                shift_expr = visit_shift_expression();
-                if (!shift_expr)
-                    CR_RETURN_AST(nullptr);
-
-                auto another = m_s<AST_relational_expression>();
-                another->m_child = rel_expr;
-                another->m_shift_expr = shift_expr;
-
-                rel_expr = another;
+                auto child = static_pointer_cast<AST_relational_expression>(left);
+                child->m_op = op;
+                auto expr = make_expr<AST_relational_expression>();
+                expr->m_child = child;
+                expr->m_shift_expr = static_pointer_cast<AST_shift_expression>(right);
+                return expr;
             }
-            CR_RETURN_AST(rel_expr);
-        }
-        index(i);
-        CR_RETURN_AST(nullptr);
-    }
-
-    // shift-expression = additive-expression, {('<<' | '>>'), additive-expression};
-    inline s_p<AST_shift_expression> CParser::visit_shift_expression()
-    {
-        CR_SHOW_STATUS();
-        auto shift_expr = m_s<AST_shift_expression>();
-        auto i = index();
-        if (auto add_expr = visit_additive_expression())
-        {
-            shift_expr->m_add_expr = add_expr;
-            while (str() == "<<" || str() == ">>")
+        case BL_SHIFT:
             {
-                shift_expr->m_op = str();
-                next();
-
-                add_expr = visit_additive_expression();
-                if (!add_expr)
-                    CR_RETURN_AST(nullptr);
-
-                auto another = m_s<AST_shift_expression>();
-                another->m_child = shift_expr;
-                another->m_add_expr = add_expr;
-
-                shift_expr = another;
+                auto child = static_pointer_cast<AST_shift_expression>(left);
+                child->m_op = op;
+                auto expr = make_expr<AST_shift_expression>();
+                expr->m_child = child;
+                expr->m_add_expr = static_pointer_cast<AST_additive_expression>(right);
+                return expr;
             }
-            CR_RETURN_AST(shift_expr);
-        }
-        index(i);
-        CR_RETURN_AST(nullptr);
-    }
-
-    // additive-expression = multiplicative-expression, {('+' | '-'), multiplicative-expression};
-    inline s_p<AST_additive_expression> CParser::visit_additive_expression()
-    {
-        CR_SHOW_STATUS();
-        auto add_expr = m_s<AST_additive_expression>();
-        auto i = index();
-        if (auto mul_expr = visit_multiplicative_expression())
-        {
-            add_expr->m_mul_expr = mul_expr;
-            while (str() == "+" || str() == "-")
+        case BL_ADDITIVE:
             {
-                add_expr->m_op = str();
-                next();
-
-                mul_expr = visit_multiplicative_expression();
-                if (!mul_expr)
-                    CR_RETURN_AST(nullptr);
-
-                auto another = m_s<AST_additive_expression>();
-                another->m_child = add_expr;
-                another->m_mul_expr = mul_expr;
-                add_expr = another;
+                auto child = static_pointer_cast<AST_additive_expression>(left);
+                child->m_op = op;
+                auto expr = make_expr<AST_additive_expression>();
+                expr->m_child = child;
+                expr->m_mul_expr = static_pointer_cast<AST_multiplicative_expression>(right);
+                return expr;
             }
-            CR_RETURN_AST(add_expr);
-        }
-        index(i);
-        CR_RETURN_AST(nullptr);
-    }
-
-    // multiplicative-expression = cast-expression, {('*' | '/' | '%'), cast-expression};
-    inline s_p<AST_multiplicative_expression> CParser::visit_multiplicative_expression()
-    {
-        CR_SHOW_STATUS();
-        auto mul_expr = m_s<AST_multiplicative_expression>();
-        auto i = index();
-        if (auto cast_expr = visit_cast_expression())
-        {
-            mul_expr->m_cast_expr = cast_expr;
-            while (str() == "*" || str() == "/" || str() == "%")
+        case BL_MULTIPLICATIVE:
             {
-                mul_expr->m_op = str();
-                next();
-
-                cast_expr = visit_cast_expression();
-                if (!cast_expr)
-                    CR_RETURN_AST(nullptr);
-
-                auto another = m_s<AST_multiplicative_expression>();
-                another->m_child = mul_expr;
-                another->m_cast_expr = cast_expr;
-                mul_expr = another;
+                auto child = static_pointer_cast<AST_multiplicative_expression>(left);
+                child->m_op = op;
+                auto expr = make_expr<AST_multiplicative_expression>();
+                expr->m_child = child;
+                expr->m_cast_expr = static_pointer_cast<AST_cast_expression>(right);
+                return expr;
             }
-            CR_RETURN_AST(mul_expr);
+        default:
+            assert(0);
+            return left;
         }
-        index(i);
-        CR_RETURN_AST(nullptr);
     }
 
     // cast-expression = unary-expression
@@ -2370,7 +3552,7 @@ namespace CodeReverse
     inline s_p<AST_cast_expression> CParser::visit_cast_expression()
     {
         CR_SHOW_STATUS();
-        auto cast_expr = m_s<AST_cast_expression>();
+        auto cast_expr = make_expr<AST_cast_expression>();
         auto i = index();
         if (auto unary_expr = visit_unary_expression())
         {
@@ -2378,12 +3560,12 @@ namespace CodeReverse
             CR_RETURN_AST(cast_expr);
         }
         index(i);
-        if (next_if("("))
+        if (next_if(SYM_L_PAREN))
         {
             if (auto type_name = visit_type_name())
             {
                 cast_expr->m_type_name = type_name;
-                if (next_if(")"))
+                if (next_if(SYM_R_PAREN))
                 {
                     if (auto another = visit_cast_expression())
                     {
@@ -2409,12 +3591,16 @@ namespace CodeReverse
     //                | '~'
     //                | '!';
     inline s_p<AST_unary_expression> CParser::visit_unary_expression()
+    {
+        return memoized(MEMO_UNARY_EXPRESSION, &CParser::parse_unary_expression);
+    }
+    inline s_p<AST_unary_expression> CParser::parse_unary_expression()
     {
         CR_SHOW_STATUS();
-        auto unary_expr = m_s<AST_unary_expression>();
-        if (str() == "++" || str() == "--")
+        auto unary_expr = make_expr<AST_unary_expression>();
+        if (is(SYM_INC) || is(SYM_DEC))
         {
-            unary_expr->m_op = str();
+            unary_expr->m_op = id();
             next();
             if (auto another = visit_unary_expression())
             {
@@ -2423,10 +3609,10 @@ namespace CodeReverse
             }
             CR_RETURN_AST(nullptr);
         }
-        if (str() == "&" || str() == "*" || str() == "+" ||
-            str() == "-" || str() == "~" || str() == "!")
+        if (is(SYM_AMP) || is(SYM_STAR) || is(SYM_PLUS) ||
+            is(SYM_MINUS) || is(SYM_TILDE) || is(SYM_NOT))
         {
-            unary_expr->m_op = str();
+            unary_expr->m_op = id();
             next();
             if (auto cast_expr = visit_cast_expression())
             {
@@ -2435,9 +3621,9 @@ namespace CodeReverse
             }
             CR_RETURN_AST(nullptr);
         }
-        if (str() == "sizeof")
+        if (is(KW_SIZEOF))
         {
-            unary_expr->m_op = str();
+            unary_expr->m_op = id();
             next();
             auto i = index();
             if (auto another = visit_unary_expression())
@@ -2446,12 +3632,12 @@ namespace CodeReverse
                 CR_RETURN_AST(unary_expr);
             }
             index(i);
-            if (next_if("("))
+            if (next_if(SYM_L_PAREN))
             {
                 if (auto type_name = visit_type_name())
                 {
                     unary_expr->m_type_name = type_name;
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         CR_RETURN_AST(unary_expr);
                     }
@@ -2460,16 +3646,16 @@ namespace CodeReverse
             index(i);
             CR_RETURN_AST(nullptr);
         }
-        if (str() == "_Alignof")
+        if (is(KW__ALIGNOF))
         {
-            unary_expr->m_op = str();
+            unary_expr->m_op = id();
             next();
-            if (next_if("("))
+            if (next_if(SYM_L_PAREN))
             {
                 if (auto type_name = visit_type_name())
                 {
                     unary_expr->m_type_name = type_name;
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         CR_RETURN_AST(unary_expr);
                     }
@@ -2496,7 +3682,7 @@ namespace CodeReverse
     inline s_p<AST_postfix_expression> CParser::visit_postfix_expression()
     {
         CR_SHOW_STATUS();
-        auto postfix_expr = m_s<AST_postfix_expression>();
+        auto postfix_expr = make_expr<AST_postfix_expression>();
         bool ok = false;
         auto i = index();
         if (auto prim_expr = visit_primary_expression())
@@ -2507,16 +3693,16 @@ namespace CodeReverse
         else
         {
             index(i);
-            if (next_if("("))
+            if (next_if(SYM_L_PAREN))
             {
                 if (auto type_name = visit_type_name())
                 {
-                    if (next_if(")") && next_if("{"))
+                    if (next_if(SYM_R_PAREN) && next_if(SYM_L_BRACE))
                     {
                         if (auto init_list = visit_initializer_list())
                         {
-                            next_if(",");
-                            if (next_if("}"))
+                            next_if(SYM_COMMA);
+                            if (next_if(SYM_R_BRACE))
                             {
                                 ok = true;
                             }
@@ -2527,24 +3713,24 @@ namespace CodeReverse
         }
         if (ok)
         {
-            while (str() == "[" || str() == "(" || str() == "." ||
-                   str() == "->" || str() == "++" || str() == "--")
+            while (is(SYM_L_BRACKET) || is(SYM_L_PAREN) || is(SYM_DOT) ||
+                   is(SYM_ARROW) || is(SYM_INC) || is(SYM_DEC))
             {
-                auto another = m_s<AST_postfix_expression>();
-                another->m_child = postfix_expr;
+                auto another = make_expr<AST_postfix_expression>();
+                another->m_child = span(postfix_expr, i);
                 postfix_expr = another;
 
-                if (next_if("["))
+                if (next_if(SYM_L_BRACKET))
                 {
-                    another->m_str = "[]";
+                    another->m_op = SYM_L_BRACKET;
                     // '[', expression, ']'
                     if (auto expr = visit_expression())
                     {
-                        if (next_if("]"))
+                        if (next_if(SYM_R_BRACKET))
                             continue;
                     }
                 }
-                else if (next_if("("))
+                else if (next_if(SYM_L_PAREN))
                 {
                     // '(', [argument-expression-list], ')'
                     auto i = index();
@@ -2554,13 +3740,13 @@ namespace CodeReverse
                         i = index();
                     }
                     index(i);
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                         continue;
                 }
-                else if (str() == "." || str() == "->")
+                else if (is(SYM_DOT) || is(SYM_ARROW))
                 {
                     // ('.' | '->'), identifier
-                    another->m_str = str();
+                    another->m_op = id();
                     next();
                     if (auto ident = visit_identifier())
                     {
@@ -2568,10 +3754,10 @@ namespace CodeReverse
                         continue;
                     }
                 }
-                else if (str() == "++" || str() == "--")
+                else if (is(SYM_INC) || is(SYM_DEC))
                 {
                     // ('++' | '--')
-                    another->m_str = str();
+                    another->m_op = id();
                     next();
                     continue;
                 }
@@ -2591,13 +3777,13 @@ namespace CodeReverse
     inline s_p<AST_primary_expression> CParser::visit_primary_expression()
     {
         CR_SHOW_STATUS();
-        auto prim_expr = m_s<AST_primary_expression>();
-        if (next_if("("))
+        auto prim_expr = make_expr<AST_primary_expression>();
+        if (next_if(SYM_L_PAREN))
         {
             if (auto expr = visit_expression())
             {
                 prim_expr->m_expr = expr;
-                if (next_if(")"))
+                if (next_if(SYM_R_PAREN))
                 {
                     prim_expr->m_type = AST_primary_expression::PE_PAREN;
                     CR_RETURN_AST(prim_expr);
@@ -2661,12 +3847,12 @@ namespace CodeReverse
     inline s_p<AST_argument_expression_list> CParser::visit_argument_expression_list()
     {
         CR_SHOW_STATUS();
-        auto arg_expr_list = m_s<AST_argument_expression_list>();
+        auto arg_expr_list = make_expr<AST_argument_expression_list>();
         auto i = index();
         if (auto assign_expr = visit_assignment_expression())
         {
             arg_expr_list->push_back(assign_expr);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
                 assign_expr = visit_assignment_expression();
                 if (!assign_expr)
@@ -2687,7 +3873,7 @@ namespace CodeReverse
     inline s_p<AST_constant> CParser::visit_constant()
     {
         CR_SHOW_STATUS();
-        auto constant = m_s<AST_constant>();
+        auto constant = m_arena.make<AST_constant>();
         switch (type())
         {
         case TK_INTEGER_LITERAL:
@@ -2700,7 +3886,7 @@ namespace CodeReverse
             constant->m_type = AST_constant::C_FLOATING;
             break;
         case TK_IDENTIFIER:
-            if (m_enum_constant_names.count(str()) > 0)
+            if (m_names.is_enum_constant(str()))
                 constant->m_type = AST_constant::C_ENUM;
             else
                 CR_RETURN_AST(nullptr);
@@ -2718,18 +3904,18 @@ namespace CodeReverse
     inline s_p<AST_generic_selection> CParser::visit_generic_selection()
     {
         CR_SHOW_STATUS();
-        auto gen_sel = m_s<AST_generic_selection>();
-        if (next_if("_Generic") && next_if("("))
+        auto gen_sel = m_arena.make<AST_generic_selection>();
+        if (next_if(KW__GENERIC) && next_if(SYM_L_PAREN))
         {
             if (auto assign_expr = visit_assignment_expression())
             {
                 gen_sel->m_assign_expr = assign_expr;
-                if (next_if(","))
+                if (next_if(SYM_COMMA))
                 {
                     if (auto gen_assoc_list = visit_generic_assoc_list())
                     {
                         gen_sel->m_gen_assoc_list = gen_assoc_list;
-                        if (next_if(")"))
+                        if (next_if(SYM_R_PAREN))
                         {
                             CR_RETURN_AST(gen_sel);
                         }
@@ -2744,11 +3930,11 @@ namespace CodeReverse
     inline s_p<AST_generic_assoc_list> CParser::visit_generic_assoc_list()
     {
         CR_SHOW_STATUS();
-        auto gen_assoc_list = m_s<AST_generic_assoc_list>();
+        auto gen_assoc_list = m_arena.make<AST_generic_assoc_list>();
         if (auto gen_assoc = visit_generic_association())
         {
             gen_assoc_list->push_back(gen_assoc);
-            while (next_if(","))
+            while (next_if(SYM_COMMA))
             {
                 gen_assoc = visit_generic_association();
                 if (!gen_assoc)
@@ -2766,10 +3952,10 @@ namespace CodeReverse
     inline s_p<AST_generic_association> CParser::visit_generic_association()
     {
         CR_SHOW_STATUS();
-        auto gen_assoc = m_s<AST_generic_association>();
-        if (next_if("default"))
+        auto gen_assoc = m_arena.make<AST_generic_association>();
+        if (next_if(KW_DEFAULT))
         {
-            if (next_if(":"))
+            if (next_if(SYM_COLON))
             {
                 if (auto assign_expr = visit_assignment_expression())
                 {
@@ -2782,7 +3968,7 @@ namespace CodeReverse
         auto i = index();
         if (auto type_name = visit_type_name())
         {
-            if (next_if(":"))
+            if (next_if(SYM_COLON))
             {
                 if (auto assign_expr = visit_assignment_expression())
                 {
@@ -2800,11 +3986,11 @@ namespace CodeReverse
     inline s_p<AST_designation> CParser::visit_designation()
     {
         CR_SHOW_STATUS();
-        auto design = m_s<AST_designation>();
+        auto design = m_arena.make<AST_designation>();
         auto i = index();
         if (auto design_list = visit_designator_list())
         {
-            if (next_if("="))
+            if (next_if(SYM_ASSIGN))
             {
                 design->m_design_list = design_list;
                 CR_RETURN_AST(design);
@@ -2818,7 +4004,7 @@ namespace CodeReverse
     inline s_p<AST_designator_list> CParser::visit_designator_list()
     {
         CR_SHOW_STATUS();
-        auto design_list = m_s<AST_designator_list>();
+        auto design_list = m_arena.make<AST_designator_list>();
         if (auto design = visit_designator())
         {
             design_list->push_back(design);
@@ -2843,19 +4029,19 @@ namespace CodeReverse
     inline s_p<AST_designator> CParser::visit_designator()
     {
         CR_SHOW_STATUS();
-        auto design = m_s<AST_designator>();
-        if (next_if("["))
+        auto design = m_arena.make<AST_designator>();
+        if (next_if(SYM_L_BRACKET))
         {
             if (auto const_expr = visit_constant_expression())
             {
                 design->m_const_expr = const_expr;
-                if (next_if("]"))
+                if (next_if(SYM_R_BRACKET))
                 {
                     CR_RETURN_AST(design);
                 }
             }
         }
-        else if (next_if("."))
+        else if (next_if(SYM_DOT))
         {
             if (auto ident = visit_identifier())
             {
@@ -2873,58 +4059,88 @@ namespace CodeReverse
     //           | iteration-statement
     //           | jump-statement
     //           | asm-statement;
+    // NOTE: The alternative is chosen by the first token:
+    //       FIRST(labeled-statement) = identifier 'case' 'default'
+    //       FIRST(compound-statement) = '{'
+    //       FIRST(selection-statement) = 'if' 'switch'
+    //       FIRST(iteration-statement) = 'while' 'do' 'for'
+    //       FIRST(jump-statement) = 'goto' 'continue' 'break' 'return'
+    //       FIRST(asm-statement) = '__asm' '__asm__'
+    //       An identifier starts a labeled-statement only if a ':' follows;
+    //       anything else starts an expression-statement.
     inline s_p<AST_statement> CParser::visit_statement()
     {
         CR_SHOW_STATUS();
-        auto stmt = m_s<AST_statement>();
+        auto stmt = m_arena.make<AST_statement>();
         auto i = index();
-        if (auto label_stmt = visit_labeled_statement())
-        {
-            stmt->m_label_stmt = label_stmt;
-            stmt->m_type = AST_statement::S_LABEL;
-            CR_RETURN_AST(stmt);
-        }
-        index(i);
-        if (auto comp_stmt = visit_compound_statement())
-        {
-            stmt->m_comp_stmt = comp_stmt;
-            stmt->m_type = AST_statement::S_COMP;
-            CR_RETURN_AST(stmt);
-        }
-        index(i);
-        if (auto expr_stmt = visit_expression_statement())
-        {
-            stmt->m_expr_stmt = expr_stmt;
-            stmt->m_type = AST_statement::S_EXPR;
-            CR_RETURN_AST(stmt);
-        }
-        index(i);
-        if (auto sel_stmt = visit_selection_statement())
-        {
-            stmt->m_sel_stmt = sel_stmt;
-            stmt->m_type = AST_statement::S_SEL;
-            CR_RETURN_AST(stmt);
-        }
-        index(i);
-        if (auto iter_stmt = visit_iteration_statement())
-        {
-            stmt->m_iter_stmt = iter_stmt;
-            stmt->m_type = AST_statement::S_ITER;
-            CR_RETURN_AST(stmt);
-        }
-        index(i);
-        if (auto jump_stmt = visit_jump_statement())
-        {
-            stmt->m_jump_stmt = jump_stmt;
-            stmt->m_type = AST_statement::S_JUMP;
-            CR_RETURN_AST(stmt);
-        }
-        index(i);
-        if (auto asm_stmt = visit_asm_statement())
+        switch (id())
         {
-            stmt->m_asm_stmt = asm_stmt;
-            stmt->m_type = AST_statement::S_ASM;
-            CR_RETURN_AST(stmt);
+        case KW_CASE: case KW_DEFAULT:
+            if (auto label_stmt = visit_labeled_statement())
+            {
+                stmt->m_label_stmt = label_stmt;
+                stmt->m_type = AST_statement::S_LABEL;
+                CR_RETURN_AST(stmt);
+            }
+            break;
+        case SYM_L_BRACE:
+            if (auto comp_stmt = visit_compound_statement())
+            {
+                stmt->m_comp_stmt = comp_stmt;
+                stmt->m_type = AST_statement::S_COMP;
+                CR_RETURN_AST(stmt);
+            }
+            break;
+        case KW_IF: case KW_SWITCH:
+            if (auto sel_stmt = visit_selection_statement())
+            {
+                stmt->m_sel_stmt = sel_stmt;
+                stmt->m_type = AST_statement::S_SEL;
+                CR_RETURN_AST(stmt);
+            }
+            break;
+        case KW_WHILE: case KW_DO: case KW_FOR:
+            if (auto iter_stmt = visit_iteration_statement())
+            {
+                stmt->m_iter_stmt = iter_stmt;
+                stmt->m_type = AST_statement::S_ITER;
+                CR_RETURN_AST(stmt);
+            }
+            break;
+        case KW_GOTO: case KW_CONTINUE: case KW_BREAK: case KW_RETURN:
+            if (auto jump_stmt = visit_jump_statement())
+            {
+                stmt->m_jump_stmt = jump_stmt;
+                stmt->m_type = AST_statement::S_JUMP;
+                CR_RETURN_AST(stmt);
+            }
+            break;
+        case KW___ASM: case KW___ASM__:
+            if (auto asm_stmt = visit_asm_statement())
+            {
+                stmt->m_asm_stmt = asm_stmt;
+                stmt->m_type = AST_statement::S_ASM;
+                CR_RETURN_AST(stmt);
+            }
+            break;
+        default:
+            if (type() == TK_IDENTIFIER && m_lexer.tokens().id(i + 1) == SYM_COLON)
+            {
+                if (auto label_stmt = visit_labeled_statement())
+                {
+                    stmt->m_label_stmt = label_stmt;
+                    stmt->m_type = AST_statement::S_LABEL;
+                    CR_RETURN_AST(stmt);
+                }
+                index(i);
+            }
+            if (auto expr_stmt = visit_expression_statement())
+            {
+                stmt->m_expr_stmt = expr_stmt;
+                stmt->m_type = AST_statement::S_EXPR;
+                CR_RETURN_AST(stmt);
+            }
+            break;
         }
         index(i);
         CR_RETURN_AST(nullptr);
@@ -2936,13 +4152,13 @@ namespace CodeReverse
     inline s_p<AST_labeled_statement> CParser::visit_labeled_statement()
     {
         CR_SHOW_STATUS();
-        auto label_stmt = m_s<AST_labeled_statement>();
-        if (next_if("case"))
+        auto label_stmt = m_arena.make<AST_labeled_statement>();
+        if (next_if(KW_CASE))
         {
             if (auto const_expr = visit_constant_expression())
             {
                 label_stmt->m_const_expr = const_expr;
-                if (next_if(":"))
+                if (next_if(SYM_COLON))
                 {
                     if (auto stmt = visit_statement())
                     {
@@ -2953,9 +4169,9 @@ namespace CodeReverse
             }
             CR_RETURN_AST(nullptr);
         }
-        if (next_if("default"))
+        if (next_if(KW_DEFAULT))
         {
-            if (next_if(":"))
+            if (next_if(SYM_COLON))
             {
                 if (auto stmt = visit_statement())
                 {
@@ -2969,7 +4185,7 @@ namespace CodeReverse
         if (auto ident = visit_identifier())
         {
             label_stmt->m_ident = ident;
-            if (next_if(":"))
+            if (next_if(SYM_COLON))
             {
                 if (auto stmt = visit_statement())
                 {
@@ -2987,7 +4203,7 @@ namespace CodeReverse
     inline s_p<AST_expression_statement> CParser::visit_expression_statement()
     {
         CR_SHOW_STATUS();
-        auto expr_stmt = m_s<AST_expression_statement>();
+        auto expr_stmt = m_arena.make<AST_expression_statement>();
         auto i = index();
         if (auto expr = visit_expression())
         {
@@ -2995,7 +4211,7 @@ namespace CodeReverse
             i = index();
         }
         index(i);
-        if (next_if(";"))
+        if (next_if(SYM_SEMICOLON))
         {
             CR_RETURN_AST(expr_stmt);
         }
@@ -3008,20 +4224,20 @@ namespace CodeReverse
     inline s_p<AST_selection_statement> CParser::visit_selection_statement()
     {
         CR_SHOW_STATUS();
-        auto sel_stmt = m_s<AST_selection_statement>();
-        if (next_if("if"))
+        auto sel_stmt = m_arena.make<AST_selection_statement>();
+        if (next_if(KW_IF))
         {
-            if (next_if("("))
+            if (next_if(SYM_L_PAREN))
             {
                 if (auto expr = visit_expression())
                 {
                     sel_stmt->m_expr = expr;
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         if (auto stmt0 = visit_statement())
                         {
                             sel_stmt->m_stmt0 = stmt0;
-                            if (next_if("else"))
+                            if (next_if(KW_ELSE))
                             {
                                 if (auto stmt1 = visit_statement())
                                 {
@@ -3038,14 +4254,14 @@ namespace CodeReverse
                 }
             }
         }
-        else if (next_if("switch"))
+        else if (next_if(KW_SWITCH))
         {
-            if (next_if("("))
+            if (next_if(SYM_L_PAREN))
             {
                 if (auto expr = visit_expression())
                 {
                     sel_stmt->m_expr = expr;
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         if (auto stmt0 = visit_statement())
                         {
@@ -3067,16 +4283,16 @@ namespace CodeReverse
     inline s_p<AST_iteration_statement> CParser::visit_iteration_statement()
     {
         CR_SHOW_STATUS();
-        auto iter_stmt = m_s<AST_iteration_statement>();
-        if (next_if("while"))
+        auto iter_stmt = m_arena.make<AST_iteration_statement>();
+        if (next_if(KW_WHILE))
         {
             iter_stmt->m_type = AST_iteration_statement::IS_WHILE;
-            if (next_if("("))
+            if (next_if(SYM_L_PAREN))
             {
                 if (auto expr0 = visit_expression())
                 {
                     iter_stmt->m_expr0 = expr0;
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         if (auto stmt = visit_statement())
                         {
@@ -3087,17 +4303,17 @@ namespace CodeReverse
                 }
             }
         }
-        else if (next_if("do"))
+        else if (next_if(KW_DO))
         {
             iter_stmt->m_type = AST_iteration_statement::IS_DO;
             if (auto stmt = visit_statement())
             {
-                if (next_if("while") && next_if("("))
+                if (next_if(KW_WHILE) && next_if(SYM_L_PAREN))
                 {
                     if (auto expr0 = visit_expression())
                     {
                         iter_stmt->m_expr0 = expr0;
-                        if (next_if(")"))
+                        if (next_if(SYM_R_PAREN))
                         {
                             CR_RETURN_AST(iter_stmt);
                         }
@@ -3105,16 +4321,16 @@ namespace CodeReverse
                 }
             }
         }
-        else if (next_if("for"))
+        else if (next_if(KW_FOR))
         {
             iter_stmt->m_type = AST_iteration_statement::IS_FOR;
-            if (next_if("("))
+            if (next_if(SYM_L_PAREN))
             {
                 auto i = index();
                 if (auto expr0 = visit_expression())
                 {
                     iter_stmt->m_expr0 = expr0;
-                    if (!next_if(";"))
+                    if (!next_if(SYM_SEMICOLON))
                         CR_RETURN_AST(nullptr);
 
                     i = index();
@@ -3135,7 +4351,7 @@ namespace CodeReverse
                     i = index();
                 }
                 index(i);
-                if (next_if(";"))
+                if (next_if(SYM_SEMICOLON))
                 {
                     i = index();
                     if (auto expr2 = visit_expression())
@@ -3144,7 +4360,7 @@ namespace CodeReverse
                         i = index();
                     }
                     index(i);
-                    if (next_if(")"))
+                    if (next_if(SYM_R_PAREN))
                     {
                         if (auto stmt = visit_statement())
                         {
@@ -3165,40 +4381,40 @@ namespace CodeReverse
     inline s_p<AST_jump_statement> CParser::visit_jump_statement()
     {
         CR_SHOW_STATUS();
-        auto jump_stmt = m_s<AST_jump_statement>();
-        if (next_if("goto"))
+        auto jump_stmt = m_arena.make<AST_jump_statement>();
+        if (next_if(KW_GOTO))
         {
             jump_stmt->m_type = AST_jump_statement::JS_GOTO;
             if (auto ident = visit_identifier())
             {
                 jump_stmt->m_ident = ident;
-                if (next_if(";"))
+                if (next_if(SYM_SEMICOLON))
                 {
                     CR_RETURN_AST(jump_stmt);
                 }
             }
         }
-        else if (next_if("continue"))
+        else if (next_if(KW_CONTINUE))
         {
             jump_stmt->m_type = AST_jump_statement::JS_CONT;
-            if (next_if(";"))
+            if (next_if(SYM_SEMICOLON))
                 CR_RETURN_AST(jump_stmt);
         }
-        else if (next_if("break"))
+        else if (next_if(KW_BREAK))
         {
             jump_stmt->m_type = AST_jump_statement::JS_BREAK;
-            if (next_if(";"))
+            if (next_if(SYM_SEMICOLON))
                 CR_RETURN_AST(jump_stmt);
         }
-        else if (next_if("return"))
+        else if (next_if(KW_RETURN))
         {
             jump_stmt->m_type = AST_jump_statement::JS_RETURN;
-            if (next_if(";"))
+            if (next_if(SYM_SEMICOLON))
                 CR_RETURN_AST(jump_stmt);
             if (auto expr = visit_expression())
             {
                 jump_stmt->m_expr = expr;
-                if (next_if(";"))
+                if (next_if(SYM_SEMICOLON))
                     CR_RETURN_AST(jump_stmt);
             }
         }
@@ -3209,18 +4425,19 @@ namespace CodeReverse
     //               | '__asm', '{', ? ... ?, '}';
     inline s_p<AST_asm_statement> CParser::visit_asm_statement()
     {
-        auto asm_stmt = m_s<AST_asm_statement>();
-        if (next_if("__asm__"))
+        CR_SHOW_STATUS();
+        auto asm_stmt = m_arena.make<AST_asm_statement>();
+        if (next_if(KW___ASM__))
         {
             auto i = paren_close();
             index(i);
-            if (next_if(";"))
+            if (next_if(SYM_SEMICOLON))
             {
                 CR_RETURN_AST(asm_stmt);
             }
             CR_RETURN_AST(nullptr);
         }
-        if (next_if("__asm"))
+        if (next_if(KW___ASM))
         {
             auto i = brace_close();
             index(i);
@@ -9,10 +9,14 @@
 
 #include <string>       // for std::string
 #include <vector>       // for std::vector
+#include <deque>        // for std::deque
+#include <map>          // for std::map
+#include <algorithm>    // for std::upper_bound
 #include <sstream>      // for std::stringstream
 #include <cstring>      // for std::strlen, std::strtol, ...
 #include <cassert>      // for assert macro
 #include <cstdarg>      // for va_list
+#include <mutex>        // for std::mutex
 
 #ifndef _countof
     #define _countof(array)  sizeof(array) / sizeof(array[0])
@@ -29,78 +33,379 @@ namespace CodeReverse
     typedef string_type::value_type     char_type;
     typedef std::stringstream           os_type;
 
+    /////////////////////////////////////////////////////////////////////////
+    // LineIndex --- the offsets of the line starts in a source buffer
+
+    class LineIndex
+    {
+    public:
+        LineIndex(const char_type *text, size_t size);
+
+        size_t line(size_t offset) const;
+        size_t line_start(size_t line) const;
+        void release();
+        void clear();
+
+    protected:
+        const char_type *                   m_text;     // NULL if released
+        size_t                              m_size;
+        mutable std::vector<unsigned int>   m_starts;   // built on demand
+
+        void build() const;
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // FileTable
+    //
+    // The files that positions refer to. A position is a file ID and a byte
+    // offset. A file here is a file name and, for a position in a source
+    // buffer, the offset and the line number where it begins in the buffer,
+    // so that a line marker begins a new file. The line and the column are
+    // counted by the line index of the buffer only when asked.
+    //
+    // The table is shared by all the scanners and is locked for each call.
+    // A buffer is held by its scanner, by each Lexer on the scanner and by
+    // each AuxInfo with an item at a position in it. When the scanner goes,
+    // the buffer keeps only its line index; when the last holder goes, the
+    // buffer and its files are freed and their slots are reused. So a
+    // position in a buffer is valid only while one of them lives.
+
+    class FileTable
+    {
+    public:
+        static FileTable& instance();
+
+        unsigned int add_buffer(const char_type *text, size_t size);
+        void release_buffer(unsigned int buffer);
+        void hold_buffer(unsigned int buffer);
+        void unhold_buffer(unsigned int buffer);
+        unsigned int buffer(unsigned int file) const;
+        size_t buffer_line(unsigned int buffer, size_t offset) const;
+        size_t buffer_column(unsigned int buffer, size_t offset) const;
+
+        unsigned int add_name(const char_type *name, size_t len);
+        unsigned int add_file(unsigned int name, size_t line);
+        unsigned int add_file(unsigned int name, size_t line,
+                              unsigned int buffer, size_t begin);
+
+        const string_type& name(unsigned int file) const;
+        unsigned int name_id(unsigned int file) const;
+        size_t line(unsigned int file, size_t offset) const;
+        size_t column(unsigned int file, size_t offset) const;
+
+    protected:
+        struct Entry
+        {
+            unsigned int    m_name;
+            unsigned int    m_buffer;   // 0 for none; or buffer index + 1
+            size_t          m_begin;
+            size_t          m_line;     // the line at m_begin
+        };
+        struct Buffer
+        {
+            LineIndex                   m_index;
+            size_t                      m_holders;
+            std::vector<unsigned int>   m_files;    // that begin in it
+        };
+        // (name, line) or ((name, line), (buffer, begin))
+        typedef std::pair<unsigned int, size_t>             line_key_type;
+        typedef std::pair<line_key_type, line_key_type>     file_key_type;
+        std::deque<string_type>                 m_names;
+        std::map<string_type, unsigned int>     m_name_map;
+        std::vector<Entry>                      m_entries;
+        std::vector<unsigned int>               m_free_entries;
+        std::map<file_key_type, unsigned int>   m_file_map;
+        std::deque<Buffer>                      m_buffers;
+        std::vector<unsigned int>               m_free_buffers;
+        mutable std::mutex                      m_mutex;
+
+        FileTable();
+        unsigned int add_name_unlocked(const char_type *name, size_t len);
+        unsigned int add_file_unlocked(unsigned int name, size_t line,
+                                       unsigned int buffer, size_t begin);
+        void unhold_buffer_unlocked(unsigned int buffer);
+    };
+
     /////////////////////////////////////////////////////////////////////////
     // Position
 
     struct Position
     {
-        string_type m_file;
-        size_t m_line;
-        size_t m_column;
+        unsigned int m_file;    // ID in FileTable
+        unsigned int m_offset;  // offset in the buffer (or column if none)
 
         Position()
-            : m_file("(anonymous)"), m_line(0), m_column(0)
+            : m_file(0), m_offset(0)    // "(anonymous)"
+        {
+        }
+        Position(unsigned int file, size_t offset)
+            : m_file(file), m_offset((unsigned int)offset)
         {
         }
         Position(const char_type *fname)
-            : m_file(fname), m_line(0), m_column(0)
+            : m_file(add(fname, 0)), m_offset(0)
         {
         }
         Position(const char_type *fname, int line)
-            : m_file(fname), m_line(line - 1), m_column(0)
+            : m_file(add(fname, line - 1)), m_offset(0)
         {
         }
         Position(const char_type *fname, int line, int column)
-            : m_file(fname), m_line(line - 1), m_column(column - 1)
+            : m_file(add(fname, line - 1)), m_offset(column - 1)
         {
         }
-        void assign(const char_type *fname, int line, int column)
+        const string_type& file() const
         {
-            m_file = fname;
-            m_line = line;
-            m_column = column;
+            return FileTable::instance().name(m_file);
         }
-        Position& operator+=(size_t skip)
+        size_t line() const
         {
-            m_column += skip;
-            return *this;
+            return FileTable::instance().line(m_file, m_offset);
         }
-        Position& operator++()
+        size_t column() const
         {
-            ++m_column;
-            return *this;
+            return FileTable::instance().column(m_file, m_offset);
         }
-        Position operator++(int)
+
+    protected:
+        static unsigned int add(const char_type *fname, size_t line)
         {
-            Position pos(*this);
-            ++m_column;
-            return pos;
+            FileTable& table = FileTable::instance();
+            return table.add_file(table.add_name(fname, strlen(fname)), line);
         }
-        void newline()
+    };
+
+    template <class CharT, class Traits>
+    inline std::basic_ostream<CharT,Traits>&
+    operator<<(std::basic_ostream<CharT,Traits>& os, const Position& pos)
+    {
+        os << pos.file() << ':' << int(pos.line() + 1) << ':' << int(pos.column() + 1);
+        return os;
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // LineIndex inlines
+
+    inline LineIndex::LineIndex(const char_type *text, size_t size)
+        : m_text(text), m_size(size)
+    {
+    }
+    inline void LineIndex::build() const
+    {
+        if (!m_starts.empty() || !m_text)
+            return;
+
+        m_starts.push_back(0);
+        const char_type *p = m_text, *end = m_text + m_size;
+        while ((p = (const char_type *)memchr(p, '\n', end - p)) != NULL)
         {
-            m_column = 0;
-            ++m_line;
+            ++p;
+            m_starts.push_back((unsigned int)(p - m_text));
         }
-        const string_type& file() const
+    }
+    // the line (from zero) of the offset
+    inline size_t LineIndex::line(size_t offset) const
+    {
+        build();
+        if (m_starts.empty())
+            return 0;
+        return std::upper_bound(m_starts.begin(), m_starts.end(), offset) -
+               m_starts.begin() - 1;
+    }
+    inline size_t LineIndex::line_start(size_t line) const
+    {
+        build();
+        if (line < m_starts.size())
+            return m_starts[line];
+        return 0;
+    }
+    // the text is going away; keeps what is needed to count lines
+    inline void LineIndex::release()
+    {
+        build();
+        m_text = NULL;
+    }
+    // nothing is kept; the lines are no longer counted
+    inline void LineIndex::clear()
+    {
+        std::vector<unsigned int>().swap(m_starts);
+        m_text = NULL;
+        m_size = 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // FileTable inlines
+
+    inline FileTable::FileTable()
+    {
+        add_file(add_name("(anonymous)", 11), 0);
+    }
+    inline FileTable& FileTable::instance()
+    {
+        static FileTable s_table;
+        return s_table;
+    }
+    // the new buffer is held by the caller
+    inline unsigned int FileTable::add_buffer(const char_type *text, size_t size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Buffer buf = { LineIndex(text, size), 1, std::vector<unsigned int>() };
+        if (m_free_buffers.size())
         {
-            return m_file;
+            unsigned int buffer = m_free_buffers.back();
+            m_free_buffers.pop_back();
+            m_buffers[buffer] = buf;
+            return buffer;
         }
-        size_t line() const
+        m_buffers.push_back(buf);
+        return (unsigned int)(m_buffers.size() - 1);
+    }
+    // the text is going away with the holder that added it
+    inline void FileTable::release_buffer(unsigned int buffer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Buffer& buf = m_buffers[buffer];
+        if (buf.m_holders > 1)
+            buf.m_index.release();
+        unhold_buffer_unlocked(buffer);
+    }
+    inline void FileTable::hold_buffer(unsigned int buffer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_buffers[buffer].m_holders;
+    }
+    inline void FileTable::unhold_buffer(unsigned int buffer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        unhold_buffer_unlocked(buffer);
+    }
+    // frees the buffer and its files after the last holder
+    inline void FileTable::unhold_buffer_unlocked(unsigned int buffer)
+    {
+        Buffer& buf = m_buffers[buffer];
+        assert(buf.m_holders > 0);
+        if (--buf.m_holders > 0)
+            return;
+
+        for (size_t i = 0; i < buf.m_files.size(); ++i)
         {
-            return m_line;
+            const Entry& entry = m_entries[buf.m_files[i]];
+            line_key_type line_key(entry.m_name, entry.m_line);
+            line_key_type buffer_key(buffer, entry.m_begin);
+            m_file_map.erase(file_key_type(line_key, buffer_key));
+            m_free_entries.push_back(buf.m_files[i]);
         }
-        size_t column() const
+        std::vector<unsigned int>().swap(buf.m_files);
+        buf.m_index.clear();
+        m_free_buffers.push_back(buffer);
+    }
+    // the buffer of the file, or -1 if none
+    inline unsigned int FileTable::buffer(unsigned int file) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries[file].m_buffer - 1;
+    }
+    // the line (from zero) of the offset in the buffer
+    inline size_t FileTable::buffer_line(unsigned int buffer, size_t offset) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_buffers[buffer].m_index.line(offset);
+    }
+    inline size_t FileTable::buffer_column(unsigned int buffer, size_t offset) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const LineIndex& index = m_buffers[buffer].m_index;
+        return offset - index.line_start(index.line(offset));
+    }
+    inline unsigned int FileTable::add_name(const char_type *name, size_t len)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return add_name_unlocked(name, len);
+    }
+    inline unsigned int
+    FileTable::add_name_unlocked(const char_type *name, size_t len)
+    {
+        string_type str(name, len);
+        std::map<string_type, unsigned int>::iterator it = m_name_map.find(str);
+        if (it != m_name_map.end())
+            return it->second;
+
+        unsigned int id = (unsigned int)m_names.size();
+        m_names.push_back(str);
+        m_name_map.insert(std::make_pair(str, id));
+        return id;
+    }
+    // a file not in a buffer: the offset of a position is the column
+    inline unsigned int FileTable::add_file(unsigned int name, size_t line)
+    {
+        return add_file(name, line, unsigned(-1), 0);
+    }
+    // the same file is added once; it lives as long as its buffer
+    inline unsigned int FileTable::add_file(unsigned int name, size_t line,
+                                            unsigned int buffer, size_t begin)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        file_key_type key(line_key_type(name, line), line_key_type(buffer, begin));
+        std::map<file_key_type, unsigned int>::iterator it;
+        it = m_file_map.find(key);
+        if (it != m_file_map.end())
+            return it->second;
+
+        unsigned int id = add_file_unlocked(name, line, buffer, begin);
+        m_file_map.insert(std::make_pair(key, id));
+        if (buffer != unsigned(-1))
+            m_buffers[buffer].m_files.push_back(id);
+        return id;
+    }
+    inline unsigned int
+    FileTable::add_file_unlocked(unsigned int name, size_t line,
+                                 unsigned int buffer, size_t begin)
+    {
+        Entry entry;
+        entry.m_name = name;
+        entry.m_buffer = buffer + 1;
+        entry.m_begin = begin;
+        entry.m_line = line;
+        if (m_free_entries.size())
         {
-            return m_column;
+            unsigned int id = m_free_entries.back();
+            m_free_entries.pop_back();
+            m_entries[id] = entry;
+            return id;
         }
-    };
+        m_entries.push_back(entry);
+        return (unsigned int)(m_entries.size() - 1);
+    }
+    // NOTE: the names are never removed, so the reference stays valid.
+    inline const string_type& FileTable::name(unsigned int file) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_names[m_entries[file].m_name];
+    }
+    inline unsigned int FileTable::name_id(unsigned int file) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries[file].m_name;
+    }
+    inline size_t FileTable::line(unsigned int file, size_t offset) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Entry& entry = m_entries[file];
+        if (entry.m_buffer == 0)
+            return entry.m_line;
 
-    template <class CharT, class Traits>
-    inline std::basic_ostream<CharT,Traits>&
-    operator<<(std::basic_ostream<CharT,Traits>& os, const Position& pos)
+        const LineIndex& index = m_buffers[entry.m_buffer - 1].m_index;
+        return entry.m_line + (index.line(offset) - index.line(entry.m_begin));
+    }
+    inline size_t FileTable::column(unsigned int file, size_t offset) const
     {
-        os << pos.file() << ':' << int(pos.line() + 1) << ':' << int(pos.column() + 1);
-        return os;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Entry& entry = m_entries[file];
+        if (entry.m_buffer == 0)
+            return offset;
+
+        const LineIndex& index = m_buffers[entry.m_buffer - 1].m_index;
+        return offset - index.line_start(index.line(offset));
     }
 
     /////////////////////////////////////////////////////////////////////////
@@ -112,11 +417,38 @@ namespace CodeReverse
         Position    m_pos;
     };
 
+    // NOTE: AuxInfo holds the buffers of the positions of its items, so
+    //       that they outlive the scanners. Add the items by add_error()
+    //       or add_warning().
     struct AuxInfo
     {
         std::vector<AuxItem>    m_errors;
         std::vector<AuxItem>    m_warnings;
 
+        AuxInfo()
+        {
+        }
+        AuxInfo(const AuxInfo& aux)
+            : m_errors(aux.m_errors), m_warnings(aux.m_warnings)
+        {
+            hold(aux.m_buffers);
+        }
+        AuxInfo& operator=(const AuxInfo& aux)
+        {
+            if (this != &aux)
+            {
+                unhold();
+                m_errors = aux.m_errors;
+                m_warnings = aux.m_warnings;
+                hold(aux.m_buffers);
+            }
+            return *this;
+        }
+        ~AuxInfo()
+        {
+            unhold();
+        }
+
         void add_error(const Position& pos, const char *fmt, ...)
         {
             va_list va;
@@ -129,6 +461,7 @@ namespace CodeReverse
             item.m_pos = pos;
             item.m_text = buf;
             m_errors.push_back(item);
+            hold(pos);
         }
         void add_warning(const Position& pos, const char *fmt, ...)
         {
@@ -142,19 +475,54 @@ namespace CodeReverse
             item.m_pos = pos;
             item.m_text = buf;
             m_warnings.push_back(item);
+            hold(pos);
         }
         void clear()
         {
             m_errors.clear();
             m_warnings.clear();
+            unhold();
         }
 
         void err_out(os_type& os) const;
+
+    protected:
+        std::vector<unsigned int>   m_buffers;  // held in FileTable
+
+        void hold(const Position& pos);
+        void hold(const std::vector<unsigned int>& buffers);
+        void unhold();
     };
 
     /////////////////////////////////////////////////////////////////////////
     // AuxInfo inlines
 
+    inline void AuxInfo::hold(const Position& pos)
+    {
+        FileTable& table = FileTable::instance();
+        unsigned int buffer = table.buffer(pos.m_file);
+        if (buffer == unsigned(-1) ||
+            std::find(m_buffers.begin(), m_buffers.end(), buffer) != m_buffers.end())
+        {
+            return;
+        }
+        table.hold_buffer(buffer);
+        m_buffers.push_back(buffer);
+    }
+    inline void AuxInfo::hold(const std::vector<unsigned int>& buffers)
+    {
+        FileTable& table = FileTable::instance();
+        for (size_t i = 0; i < buffers.size(); ++i)
+            table.hold_buffer(buffers[i]);
+        m_buffers = buffers;
+    }
+    inline void AuxInfo::unhold()
+    {
+        FileTable& table = FileTable::instance();
+        for (size_t i = 0; i < m_buffers.size(); ++i)
+            table.unhold_buffer(m_buffers[i]);
+        m_buffers.clear();
+    }
     inline void AuxInfo::err_out(os_type& os) const
     {
         for (size_t i = 0; i < m_errors.size(); ++i)
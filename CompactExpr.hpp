@@ -0,0 +1,1057 @@
+// CompactExpr.hpp --- CodeReverse compact expressions
+// Copyright (C) 2017 Katayama Hirofumi MZ. License: MIT License
+#ifndef CODEREVERSE_COMPACT_EXPR_HPP
+#define CODEREVERSE_COMPACT_EXPR_HPP
+
+#include "AST.hpp"
+
+/////////////////////////////////////////////////////////////////////////
+
+namespace CodeReverse
+{
+    /////////////////////////////////////////////////////////////////////////
+    // ExprWalker --- finds the expressions in the declarations and statements
+    //
+    // walk() goes down the nodes that are not expressions and calls
+    // on_expr() for each field that holds an expression, so that a subclass
+    // can replace it. It does not go into the expressions, nor into the
+    // lazy bodies not parsed yet.
+
+    class ExprWalker
+    {
+    public:
+        virtual ~ExprWalker()
+        {
+        }
+
+        void walk(AST_translation_unit *trans_unit);
+        void walk(AST_external_declaration *ext_decl);
+        void walk(AST_function_definition *func_def);
+        void walk(AST_declaration *decl);
+        void walk(AST_declaration_specifiers *decl_specs);
+        void walk(AST_type_specifier *type_spec);
+        void walk(AST_alignment_specifier *align_spec);
+        void walk(AST_declarator *declor);
+        void walk(AST_direct_declarator *dir_declor);
+        void walk(AST_parameter_type_list *param_type_list);
+        void walk(AST_parameter_declaration *param_decl);
+        void walk(AST_abstract_declarator *abst_declor);
+        void walk(AST_direct_abstract_declarator *dir_abst_declor);
+        void walk(AST_declaration_list *decl_list);
+        void walk(AST_compound_statement *comp_stmt);
+        void walk(AST_init_declarator_list *init_declor_list);
+        void walk(AST_initializer *init);
+        void walk(AST_initializer_list *init_list);
+        void walk(AST_static_assert_declaration *static_assert_decl);
+        void walk(AST_struct_or_union_specifier *su_spec);
+        void walk(AST_struct_declaration *struct_decl);
+        void walk(AST_specifier_qualifier_list *spec_qual_list);
+        void walk(AST_enum_specifier *enum_spec);
+        void walk(AST_type_name *type_name);
+        void walk(AST_statement *stmt);
+        void walk(AST_generic_selection *gen_sel);
+
+    protected:
+        virtual void on_expr(s_p<AST_expression>& expr) = 0;
+        virtual void on_expr(s_p<AST_assignment_expression>& assign_expr) = 0;
+        virtual void on_expr(s_p<AST_constant_expression>& const_expr) = 0;
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // ExprCompactor --- turns the expressions into the compact form
+    //
+    // The new nodes are made in the arena given. They point to the type
+    // names, identifiers and constants of the full form, but to no other
+    // node of it, so that the rest of the full form can be thrown away.
+
+    class ExprCompactor : public ExprWalker
+    {
+    public:
+        ExprCompactor(AST_arena& arena);
+
+        s_p<AST_expr> compact(AST_expression *expr);
+        s_p<AST_expr> compact(AST_assignment_expression *assign_expr);
+        s_p<AST_expr> compact(AST_constant_expression *const_expr);
+        s_p<AST_expr> compact(AST_conditional_expression *cond_expr);
+        s_p<AST_expr> compact(AST_logical_or_expression *log_or_expr);
+        s_p<AST_expr> compact(AST_logical_and_expression *log_and_expr);
+        s_p<AST_expr> compact(AST_inclusive_or_expression *inc_or_expr);
+        s_p<AST_expr> compact(AST_exclusive_or_expression *exc_or_expr);
+        s_p<AST_expr> compact(AST_and_expression *and_expr);
+        s_p<AST_expr> compact(AST_equality_expression *equ_expr);
+        s_p<AST_expr> compact(AST_relational_expression *rel_expr);
+        s_p<AST_expr> compact(AST_shift_expression *shift_expr);
+        s_p<AST_expr> compact(AST_additive_expression *add_expr);
+        s_p<AST_expr> compact(AST_multiplicative_expression *mul_expr);
+        s_p<AST_expr> compact(AST_cast_expression *cast_expr);
+        s_p<AST_expr> compact(AST_unary_expression *unary_expr);
+        s_p<AST_expr> compact(AST_postfix_expression *postfix_expr);
+        s_p<AST_expr> compact(AST_primary_expression *prim_expr);
+
+    protected:
+        AST_arena& m_arena;
+
+        virtual void on_expr(s_p<AST_expression>& expr);
+        virtual void on_expr(s_p<AST_assignment_expression>& assign_expr);
+        virtual void on_expr(s_p<AST_constant_expression>& const_expr);
+
+        s_p<AST_expr> make(const AST_base *from, int type, TokenID op,
+                           s_p<AST_expr> lhs, s_p<AST_expr> rhs = nullptr);
+        template <typename T_ITEM>
+        s_p<AST_expr> fold(AST_vector<T_ITEM>& vec, TokenID op);
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // ExprExpander --- gives the compact expressions their full form back
+    //
+    // For the code written for the full form. walk() expands the fields of
+    // a tree in place; the functions below expand one expression. The new
+    // nodes are made in the arena given.
+
+    class ExprExpander : public ExprWalker
+    {
+    public:
+        ExprExpander(AST_arena& arena);
+
+        s_p<AST_expression> expression(AST_expr *expr);
+        s_p<AST_assignment_expression> assignment_expression(AST_expr *expr);
+        s_p<AST_constant_expression> constant_expression(AST_expr *expr);
+        s_p<AST_conditional_expression> conditional_expression(AST_expr *expr);
+        s_p<AST_logical_or_expression> logical_or_expression(AST_expr *expr);
+        s_p<AST_logical_and_expression> logical_and_expression(AST_expr *expr);
+        s_p<AST_inclusive_or_expression> inclusive_or_expression(AST_expr *expr);
+        s_p<AST_exclusive_or_expression> exclusive_or_expression(AST_expr *expr);
+        s_p<AST_and_expression> and_expression(AST_expr *expr);
+        s_p<AST_equality_expression> equality_expression(AST_expr *expr);
+        s_p<AST_relational_expression> relational_expression(AST_expr *expr);
+        s_p<AST_shift_expression> shift_expression(AST_expr *expr);
+        s_p<AST_additive_expression> additive_expression(AST_expr *expr);
+        s_p<AST_multiplicative_expression> multiplicative_expression(AST_expr *expr);
+        s_p<AST_cast_expression> cast_expression(AST_expr *expr);
+        s_p<AST_unary_expression> unary_expression(AST_expr *expr);
+        s_p<AST_postfix_expression> postfix_expression(AST_expr *expr);
+        s_p<AST_primary_expression> primary_expression(AST_expr *expr);
+
+    protected:
+        AST_arena& m_arena;
+
+        // the levels of the binary operators, the loosest first
+        enum BinaryLevel
+        {
+            LV_NONE,
+            LV_COMMA,
+            LV_LOGICAL_OR,
+            LV_LOGICAL_AND,
+            LV_INCLUSIVE_OR,
+            LV_EXCLUSIVE_OR,
+            LV_AND,
+            LV_EQUALITY,
+            LV_RELATIONAL,
+            LV_SHIFT,
+            LV_ADDITIVE,
+            LV_MULTIPLICATIVE
+        };
+        template <typename T_AST>
+        s_p<T_AST> make(const AST_expr *expr);
+        static BinaryLevel binary_level(const AST_expr *expr);
+        static void operands(AST_expr *expr, BinaryLevel level,
+                             std::vector<AST_expr *>& items);
+
+        virtual void on_expr(s_p<AST_expression>& expr);
+        virtual void on_expr(s_p<AST_assignment_expression>& assign_expr);
+        virtual void on_expr(s_p<AST_constant_expression>& const_expr);
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // ExprWalker inlines
+
+    inline void ExprWalker::walk(AST_translation_unit *trans_unit)
+    {
+        if (!trans_unit)
+            return;
+        for (auto& ext_decl : trans_unit->m_vec)
+        {
+            walk(ext_decl.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_external_declaration *ext_decl)
+    {
+        if (!ext_decl)
+            return;
+        walk(ext_decl->m_decl.get());
+        walk(ext_decl->m_func_def.get());
+    }
+    inline void ExprWalker::walk(AST_function_definition *func_def)
+    {
+        if (!func_def)
+            return;
+        walk(func_def->m_decl_specs.get());
+        walk(func_def->m_declor.get());
+        walk(func_def->m_decl_list.get());
+        walk(func_def->m_comp_stmt.get());
+    }
+    inline void ExprWalker::walk(AST_declaration *decl)
+    {
+        if (!decl)
+            return;
+        walk(decl->m_decl_specs.get());
+        walk(decl->m_init_declor_list.get());
+        walk(decl->m_static_assert_decl.get());
+    }
+    inline void ExprWalker::walk(AST_declaration_specifiers *decl_specs)
+    {
+        if (!decl_specs)
+            return;
+        for (auto& decl_spec : decl_specs->m_vec)
+        {
+            walk(decl_spec->m_type_spec.get());
+            walk(decl_spec->m_align_spec.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_type_specifier *type_spec)
+    {
+        if (!type_spec)
+            return;
+        if (type_spec->m_atom_type_spec)
+            walk(type_spec->m_atom_type_spec->m_type_name.get());
+        walk(type_spec->m_su_spec.get());
+        walk(type_spec->m_enum_spec.get());
+    }
+    inline void ExprWalker::walk(AST_alignment_specifier *align_spec)
+    {
+        if (!align_spec)
+            return;
+        walk(align_spec->m_type_name.get());
+        on_expr(align_spec->m_const_expr);
+    }
+    inline void ExprWalker::walk(AST_declarator *declor)
+    {
+        if (!declor)
+            return;
+        walk(declor->m_dir_declor.get());
+    }
+    inline void ExprWalker::walk(AST_direct_declarator *dir_declor)
+    {
+        for (; dir_declor; dir_declor = dir_declor->m_child.get())
+        {
+            walk(dir_declor->m_declor.get());
+            on_expr(dir_declor->m_assign_expr);
+            walk(dir_declor->m_param_type_list.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_parameter_type_list *param_type_list)
+    {
+        if (!param_type_list || !param_type_list->m_param_list)
+            return;
+        for (auto& param_decl : param_type_list->m_param_list->m_vec)
+        {
+            walk(param_decl.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_parameter_declaration *param_decl)
+    {
+        if (!param_decl)
+            return;
+        walk(param_decl->m_decl_specs.get());
+        walk(param_decl->m_declor.get());
+        walk(param_decl->m_abst_declor.get());
+    }
+    inline void ExprWalker::walk(AST_abstract_declarator *abst_declor)
+    {
+        if (!abst_declor)
+            return;
+        walk(abst_declor->m_dir_abst_declor.get());
+    }
+    inline void ExprWalker::walk(AST_direct_abstract_declarator *dir_abst_declor)
+    {
+        for (; dir_abst_declor; dir_abst_declor = dir_abst_declor->m_child.get())
+        {
+            walk(dir_abst_declor->m_abst_declor.get());
+            walk(dir_abst_declor->m_param_type_list.get());
+            on_expr(dir_abst_declor->m_assign_expr);
+        }
+    }
+    inline void ExprWalker::walk(AST_declaration_list *decl_list)
+    {
+        if (!decl_list)
+            return;
+        for (auto& decl : decl_list->m_vec)
+        {
+            walk(decl.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_compound_statement *comp_stmt)
+    {
+        if (!comp_stmt)
+            return;
+        for (auto& item : comp_stmt->m_items.m_vec)
+        {
+            walk(item->m_decl.get());
+            walk(item->m_stmt.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_init_declarator_list *init_declor_list)
+    {
+        if (!init_declor_list)
+            return;
+        for (auto& init_declor : init_declor_list->m_vec)
+        {
+            walk(init_declor->m_declor.get());
+            walk(init_declor->m_init.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_initializer *init)
+    {
+        if (!init)
+            return;
+        walk(init->m_init_list.get());
+        on_expr(init->m_assign_expr);
+    }
+    inline void ExprWalker::walk(AST_initializer_list *init_list)
+    {
+        if (!init_list)
+            return;
+        for (auto& design_init : init_list->m_vec)
+        {
+            if (auto& design = design_init->m_design)
+            {
+                if (auto& design_list = design->m_design_list)
+                {
+                    for (auto& designator : design_list->m_vec)
+                    {
+                        on_expr(designator->m_const_expr);
+                    }
+                }
+            }
+            walk(design_init->m_init.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_static_assert_declaration *static_assert_decl)
+    {
+        if (!static_assert_decl)
+            return;
+        on_expr(static_assert_decl->m_const_expr);
+    }
+    inline void ExprWalker::walk(AST_struct_or_union_specifier *su_spec)
+    {
+        if (!su_spec || !su_spec->m_struct_decl_list)
+            return;
+        for (auto& struct_decl : su_spec->m_struct_decl_list->m_vec)
+        {
+            walk(struct_decl.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_struct_declaration *struct_decl)
+    {
+        if (!struct_decl)
+            return;
+        walk(struct_decl->m_spec_qual_list.get());
+        if (auto& struct_declor_list = struct_decl->m_struct_declor_list)
+        {
+            for (auto& struct_declor : struct_declor_list->m_vec)
+            {
+                on_expr(struct_declor->m_const_expr);
+                walk(struct_declor->m_declor.get());
+            }
+        }
+        walk(struct_decl->m_static_assert_decl.get());
+    }
+    inline void ExprWalker::walk(AST_specifier_qualifier_list *spec_qual_list)
+    {
+        if (!spec_qual_list)
+            return;
+        for (auto& spec_qual : spec_qual_list->m_vec)
+        {
+            walk(spec_qual->m_type_spec.get());
+        }
+    }
+    inline void ExprWalker::walk(AST_enum_specifier *enum_spec)
+    {
+        if (!enum_spec || !enum_spec->m_enum_list)
+            return;
+        for (auto& enumor : enum_spec->m_enum_list->m_vec)
+        {
+            on_expr(enumor->m_const_expr);
+        }
+    }
+    inline void ExprWalker::walk(AST_type_name *type_name)
+    {
+        if (!type_name)
+            return;
+        walk(type_name->m_spec_qual_list.get());
+        walk(type_name->m_abst_declor.get());
+    }
+    inline void ExprWalker::walk(AST_statement *stmt)
+    {
+        if (!stmt)
+            return;
+        if (auto& label_stmt = stmt->m_label_stmt)
+        {
+            on_expr(label_stmt->m_const_expr);
+            walk(label_stmt->m_stmt.get());
+        }
+        walk(stmt->m_comp_stmt.get());
+        if (auto& expr_stmt = stmt->m_expr_stmt)
+        {
+            on_expr(expr_stmt->m_expr);
+        }
+        if (auto& sel_stmt = stmt->m_sel_stmt)
+        {
+            on_expr(sel_stmt->m_expr);
+            walk(sel_stmt->m_stmt0.get());
+            walk(sel_stmt->m_stmt1.get());
+        }
+        if (auto& iter_stmt = stmt->m_iter_stmt)
+        {
+            on_expr(iter_stmt->m_expr0);
+            on_expr(iter_stmt->m_expr1);
+            on_expr(iter_stmt->m_expr2);
+            walk(iter_stmt->m_decl.get());
+            walk(iter_stmt->m_stmt.get());
+        }
+        if (auto& jump_stmt = stmt->m_jump_stmt)
+        {
+            on_expr(jump_stmt->m_expr);
+        }
+    }
+    inline void ExprWalker::walk(AST_generic_selection *gen_sel)
+    {
+        if (!gen_sel)
+            return;
+        on_expr(gen_sel->m_assign_expr);
+        if (auto& gen_assoc_list = gen_sel->m_gen_assoc_list)
+        {
+            for (auto& gen_assoc : gen_assoc_list->m_vec)
+            {
+                on_expr(gen_assoc->m_assign_expr);
+            }
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // ExprCompactor inlines
+
+    inline ExprCompactor::ExprCompactor(AST_arena& arena) : m_arena(arena)
+    {
+    }
+    inline void ExprCompactor::on_expr(s_p<AST_expression>& expr)
+    {
+        if (!expr || expr->m_compact)
+            return;
+        auto compact_expr = m_arena.make<AST_expression>();
+        compact_expr->m_first = expr->m_first;
+        compact_expr->m_last = expr->m_last;
+        compact_expr->m_compact = compact(expr.get());
+        expr = compact_expr;
+    }
+    inline void ExprCompactor::on_expr(s_p<AST_assignment_expression>& assign_expr)
+    {
+        if (!assign_expr || assign_expr->m_compact)
+            return;
+        auto compact_expr = m_arena.make<AST_assignment_expression>();
+        compact_expr->m_first = assign_expr->m_first;
+        compact_expr->m_last = assign_expr->m_last;
+        compact_expr->m_compact = compact(assign_expr.get());
+        assign_expr = compact_expr;
+    }
+    inline void ExprCompactor::on_expr(s_p<AST_constant_expression>& const_expr)
+    {
+        if (!const_expr || const_expr->m_compact)
+            return;
+        auto compact_expr = m_arena.make<AST_constant_expression>();
+        compact_expr->m_first = const_expr->m_first;
+        compact_expr->m_last = const_expr->m_last;
+        compact_expr->m_compact = compact(const_expr.get());
+        const_expr = compact_expr;
+    }
+    inline s_p<AST_expr>
+    ExprCompactor::make(const AST_base *from, int type, TokenID op,
+                        s_p<AST_expr> lhs, s_p<AST_expr> rhs)
+    {
+        auto expr = m_arena.make<AST_expr>();
+        expr->m_first = from->m_first;
+        expr->m_last = from->m_last;
+        expr->m_type = decltype(expr->m_type)(type);
+        expr->m_op = op;
+        expr->m_lhs = lhs;
+        expr->m_rhs = rhs;
+        return expr;
+    }
+    // the items joined by op from the left
+    template <typename T_ITEM>
+    inline s_p<AST_expr>
+    ExprCompactor::fold(AST_vector<T_ITEM>& vec, TokenID op)
+    {
+        s_p<AST_expr> expr;
+        for (auto& item : vec.m_vec)
+        {
+            auto operand = compact(item.get());
+            if (expr)
+            {
+                auto lhs = expr;
+                expr = make(item.get(), AST_expr::E_BINARY, op, lhs, operand);
+                expr->m_first = lhs->m_first;
+            }
+            else
+                expr = operand;
+        }
+        return expr;
+    }
+
+    inline s_p<AST_expr> ExprCompactor::compact(AST_expression *expr)
+    {
+        if (expr->m_compact)
+            return expr->m_compact;
+        return fold(*expr, SYM_COMMA);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_assignment_expression *assign_expr)
+    {
+        if (assign_expr->m_compact)
+            return assign_expr->m_compact;
+        if (assign_expr->m_cond_expr)
+            return compact(assign_expr->m_cond_expr.get());
+        return make(assign_expr, AST_expr::E_ASSIGN, assign_expr->m_assign_op,
+                    compact(assign_expr->m_unary_expr.get()),
+                    compact(assign_expr->m_child.get()));
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_constant_expression *const_expr)
+    {
+        if (const_expr->m_compact)
+            return const_expr->m_compact;
+        return compact(const_expr->m_cond_expr.get());
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_conditional_expression *cond_expr)
+    {
+        auto expr = compact(cond_expr->m_log_or_expr.get());
+        if (!cond_expr->m_expr)
+            return expr;
+        expr = make(cond_expr, AST_expr::E_COND, TID_NONE, expr, compact(cond_expr->m_expr.get()));
+        expr->m_third = compact(cond_expr->m_child.get());
+        return expr;
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_logical_or_expression *log_or_expr)
+    {
+        return fold(*log_or_expr, SYM_OR_OR);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_logical_and_expression *log_and_expr)
+    {
+        return fold(*log_and_expr, SYM_AND_AND);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_inclusive_or_expression *inc_or_expr)
+    {
+        return fold(*inc_or_expr, SYM_BAR);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_exclusive_or_expression *exc_or_expr)
+    {
+        return fold(*exc_or_expr, SYM_CARET);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_and_expression *and_expr)
+    {
+        return fold(*and_expr, SYM_AMP);
+    }
+    // NOTE: In the left associative rules below, the operator is kept by
+    //       the left operand (m_child) and not by the node that joins them.
+    inline s_p<AST_expr> ExprCompactor::compact(AST_equality_expression *equ_expr)
+    {
+        auto rhs = compact(equ_expr->m_rel_expr.get());
+        if (!equ_expr->m_child)
+            return rhs;
+        return make(equ_expr, AST_expr::E_BINARY, equ_expr->m_child->m_op,
+                    compact(equ_expr->m_child.get()), rhs);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_relational_expression *rel_expr)
+    {
+        auto rhs = compact(rel_expr->m_shift_expr.get());
+        if (!rel_expr->m_child)
+            return rhs;
+        return make(rel_expr, AST_expr::E_BINARY, rel_expr->m_child->m_op,
+                    compact(rel_expr->m_child.get()), rhs);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_shift_expression *shift_expr)
+    {
+        auto rhs = compact(shift_expr->m_add_expr.get());
+        if (!shift_expr->m_child)
+            return rhs;
+        return make(shift_expr, AST_expr::E_BINARY, shift_expr->m_child->m_op,
+                    compact(shift_expr->m_child.get()), rhs);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_additive_expression *add_expr)
+    {
+        auto rhs = compact(add_expr->m_mul_expr.get());
+        if (!add_expr->m_child)
+            return rhs;
+        return make(add_expr, AST_expr::E_BINARY, add_expr->m_child->m_op,
+                    compact(add_expr->m_child.get()), rhs);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_multiplicative_expression *mul_expr)
+    {
+        auto rhs = compact(mul_expr->m_cast_expr.get());
+        if (!mul_expr->m_child)
+            return rhs;
+        return make(mul_expr, AST_expr::E_BINARY, mul_expr->m_child->m_op,
+                    compact(mul_expr->m_child.get()), rhs);
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_cast_expression *cast_expr)
+    {
+        if (cast_expr->m_unary_expr)
+            return compact(cast_expr->m_unary_expr.get());
+        walk(cast_expr->m_type_name.get());
+        auto expr = make(cast_expr, AST_expr::E_CAST, TID_NONE, compact(cast_expr->m_child.get()));
+        expr->m_type_name = cast_expr->m_type_name;
+        return expr;
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_unary_expression *unary_expr)
+    {
+        if (unary_expr->m_postfix_expr)
+            return compact(unary_expr->m_postfix_expr.get());
+        if (unary_expr->m_child)
+        {
+            return make(unary_expr, AST_expr::E_UNARY, unary_expr->m_op,
+                        compact(unary_expr->m_child.get()));
+        }
+        if (unary_expr->m_cast_expr)
+        {
+            return make(unary_expr, AST_expr::E_UNARY, unary_expr->m_op,
+                        compact(unary_expr->m_cast_expr.get()));
+        }
+        walk(unary_expr->m_type_name.get());
+        auto expr = make(unary_expr, AST_expr::E_UNARY_TYPE, unary_expr->m_op, nullptr);
+        expr->m_type_name = unary_expr->m_type_name;
+        return expr;
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_postfix_expression *postfix_expr)
+    {
+        if (postfix_expr->m_prim_expr)
+            return compact(postfix_expr->m_prim_expr.get());
+        if (!postfix_expr->m_child)
+            return make(postfix_expr, AST_expr::E_COMPOUND, TID_NONE, nullptr);
+
+        auto lhs = compact(postfix_expr->m_child.get());
+        if (postfix_expr->m_op == SYM_L_BRACKET)
+        {
+            s_p<AST_expr> rhs;
+            if (postfix_expr->m_expr)
+                rhs = compact(postfix_expr->m_expr.get());
+            return make(postfix_expr, AST_expr::E_INDEX, TID_NONE, lhs, rhs);
+        }
+        if (postfix_expr->m_op == SYM_DOT || postfix_expr->m_op == SYM_ARROW)
+        {
+            auto expr = make(postfix_expr, AST_expr::E_MEMBER, postfix_expr->m_op, lhs);
+            expr->m_ident = postfix_expr->m_ident;
+            return expr;
+        }
+        if (postfix_expr->m_op != TID_NONE)
+            return make(postfix_expr, AST_expr::E_POSTFIX, postfix_expr->m_op, lhs);
+
+        auto expr = make(postfix_expr, AST_expr::E_CALL, TID_NONE, lhs);
+        if (auto& arg_expr_list = postfix_expr->m_arg_expr_list)
+        {
+            for (auto& assign_expr : arg_expr_list->m_vec)
+            {
+                expr->m_args.push_back(compact(assign_expr.get()));
+            }
+        }
+        return expr;
+    }
+    inline s_p<AST_expr> ExprCompactor::compact(AST_primary_expression *prim_expr)
+    {
+        s_p<AST_expr> expr;
+        switch (prim_expr->m_type)
+        {
+        case AST_primary_expression::PE_IDENT:
+            expr = make(prim_expr, AST_expr::E_IDENT, TID_NONE, nullptr);
+            expr->m_ident = prim_expr->m_ident;
+            break;
+        case AST_primary_expression::PE_CONST:
+            expr = make(prim_expr, AST_expr::E_CONST, TID_NONE, nullptr);
+            expr->m_const = prim_expr->m_const;
+            break;
+        case AST_primary_expression::PE_STR:
+            expr = make(prim_expr, AST_expr::E_STR, TID_NONE, nullptr);
+            expr->m_str = prim_expr->m_str;
+            expr->m_fix = prim_expr->m_fix;
+            break;
+        case AST_primary_expression::PE_PAREN:
+            expr = make(prim_expr, AST_expr::E_PAREN, TID_NONE, compact(prim_expr->m_expr.get()));
+            break;
+        case AST_primary_expression::PE_GEN:
+            walk(prim_expr->m_gen_sel.get());
+            expr = make(prim_expr, AST_expr::E_GENERIC, TID_NONE, nullptr);
+            expr->m_gen_sel = prim_expr->m_gen_sel;
+            break;
+        }
+        return expr;
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // ExprExpander inlines
+
+    inline ExprExpander::ExprExpander(AST_arena& arena) : m_arena(arena)
+    {
+    }
+    inline void ExprExpander::on_expr(s_p<AST_expression>& expr)
+    {
+        if (expr && expr->m_compact)
+            expr = expression(expr->m_compact.get());
+    }
+    inline void ExprExpander::on_expr(s_p<AST_assignment_expression>& assign_expr)
+    {
+        if (assign_expr && assign_expr->m_compact)
+            assign_expr = assignment_expression(assign_expr->m_compact.get());
+    }
+    inline void ExprExpander::on_expr(s_p<AST_constant_expression>& const_expr)
+    {
+        if (const_expr && const_expr->m_compact)
+            const_expr = constant_expression(const_expr->m_compact.get());
+    }
+    // a node of the full form over the tokens of the expression
+    template <typename T_AST>
+    inline s_p<T_AST> ExprExpander::make(const AST_expr *expr)
+    {
+        auto ret = m_arena.make<T_AST>();
+        ret->m_first = expr->m_first;
+        ret->m_last = expr->m_last;
+        return ret;
+    }
+    inline ExprExpander::BinaryLevel ExprExpander::binary_level(const AST_expr *expr)
+    {
+        if (expr->m_type != AST_expr::E_BINARY)
+            return LV_NONE;
+
+        switch (expr->m_op)
+        {
+        case SYM_COMMA:
+            return LV_COMMA;
+        case SYM_OR_OR:
+            return LV_LOGICAL_OR;
+        case SYM_AND_AND:
+            return LV_LOGICAL_AND;
+        case SYM_BAR:
+            return LV_INCLUSIVE_OR;
+        case SYM_CARET:
+            return LV_EXCLUSIVE_OR;
+        case SYM_AMP:
+            return LV_AND;
+        case SYM_EQ: case SYM_NE:
+            return LV_EQUALITY;
+        case SYM_LT: case SYM_GT: case SYM_LE: case SYM_GE:
+            return LV_RELATIONAL;
+        case SYM_SHL: case SYM_SHR:
+            return LV_SHIFT;
+        case SYM_PLUS: case SYM_MINUS:
+            return LV_ADDITIVE;
+        default:
+            assert(expr->m_op == SYM_STAR || expr->m_op == SYM_SLASH ||
+                   expr->m_op == SYM_PERCENT);
+            return LV_MULTIPLICATIVE;
+        }
+    }
+    // the operands joined by the operators of the level, from the left
+    inline void
+    ExprExpander::operands(AST_expr *expr, BinaryLevel level,
+                           std::vector<AST_expr *>& items)
+    {
+        items.clear();
+        while (binary_level(expr) == level)
+        {
+            items.push_back(expr->m_rhs.get());
+            expr = expr->m_lhs.get();
+        }
+        items.push_back(expr);
+        std::reverse(items.begin(), items.end());
+    }
+
+    inline s_p<AST_expression> ExprExpander::expression(AST_expr *expr)
+    {
+        auto ret = make<AST_expression>(expr);
+        std::vector<AST_expr *> items;
+        operands(expr, LV_COMMA, items);
+        for (auto item : items)
+        {
+            ret->push_back(assignment_expression(item));
+        }
+        return ret;
+    }
+    inline s_p<AST_assignment_expression> ExprExpander::assignment_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_assignment_expression>(expr);
+        if (expr->m_type == AST_expr::E_ASSIGN)
+        {
+            ret->m_unary_expr = unary_expression(expr->m_lhs.get());
+            ret->m_assign_op = expr->m_op;
+            ret->m_child = assignment_expression(expr->m_rhs.get());
+        }
+        else
+        {
+            ret->m_cond_expr = conditional_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_constant_expression> ExprExpander::constant_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_constant_expression>(expr);
+        ret->m_cond_expr = conditional_expression(expr);
+        return ret;
+    }
+    inline s_p<AST_conditional_expression> ExprExpander::conditional_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_conditional_expression>(expr);
+        if (expr->m_type == AST_expr::E_COND)
+        {
+            ret->m_log_or_expr = logical_or_expression(expr->m_lhs.get());
+            ret->m_expr = expression(expr->m_rhs.get());
+            ret->m_child = conditional_expression(expr->m_third.get());
+        }
+        else
+        {
+            ret->m_log_or_expr = logical_or_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_logical_or_expression> ExprExpander::logical_or_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_logical_or_expression>(expr);
+        std::vector<AST_expr *> items;
+        operands(expr, LV_LOGICAL_OR, items);
+        for (auto item : items)
+        {
+            ret->push_back(logical_and_expression(item));
+        }
+        return ret;
+    }
+    inline s_p<AST_logical_and_expression> ExprExpander::logical_and_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_logical_and_expression>(expr);
+        std::vector<AST_expr *> items;
+        operands(expr, LV_LOGICAL_AND, items);
+        for (auto item : items)
+        {
+            ret->push_back(inclusive_or_expression(item));
+        }
+        return ret;
+    }
+    inline s_p<AST_inclusive_or_expression> ExprExpander::inclusive_or_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_inclusive_or_expression>(expr);
+        std::vector<AST_expr *> items;
+        operands(expr, LV_INCLUSIVE_OR, items);
+        for (auto item : items)
+        {
+            ret->push_back(exclusive_or_expression(item));
+        }
+        return ret;
+    }
+    inline s_p<AST_exclusive_or_expression> ExprExpander::exclusive_or_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_exclusive_or_expression>(expr);
+        std::vector<AST_expr *> items;
+        operands(expr, LV_EXCLUSIVE_OR, items);
+        for (auto item : items)
+        {
+            ret->push_back(and_expression(item));
+        }
+        return ret;
+    }
+    inline s_p<AST_and_expression> ExprExpander::and_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_and_expression>(expr);
+        std::vector<AST_expr *> items;
+        operands(expr, LV_AND, items);
+        for (auto item : items)
+        {
+            ret->push_back(equality_expression(item));
+        }
+        return ret;
+    }
+    inline s_p<AST_equality_expression> ExprExpander::equality_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_equality_expression>(expr);
+        if (binary_level(expr) == LV_EQUALITY)
+        {
+            ret->m_child = equality_expression(expr->m_lhs.get());
+            ret->m_child->m_op = expr->m_op;
+            ret->m_rel_expr = relational_expression(expr->m_rhs.get());
+        }
+        else
+        {
+            ret->m_rel_expr = relational_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_relational_expression> ExprExpander::relational_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_relational_expression>(expr);
+        if (binary_level(expr) == LV_RELATIONAL)
+        {
+            ret->m_child = relational_expression(expr->m_lhs.get());
+            ret->m_child->m_op = expr->m_op;
+            ret->m_shift_expr = shift_expression(expr->m_rhs.get());
+        }
+        else
+        {
+            ret->m_shift_expr = shift_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_shift_expression> ExprExpander::shift_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_shift_expression>(expr);
+        if (binary_level(expr) == LV_SHIFT)
+        {
+            ret->m_child = shift_expression(expr->m_lhs.get());
+            ret->m_child->m_op = expr->m_op;
+            ret->m_add_expr = additive_expression(expr->m_rhs.get());
+        }
+        else
+        {
+            ret->m_add_expr = additive_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_additive_expression> ExprExpander::additive_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_additive_expression>(expr);
+        if (binary_level(expr) == LV_ADDITIVE)
+        {
+            ret->m_child = additive_expression(expr->m_lhs.get());
+            ret->m_child->m_op = expr->m_op;
+            ret->m_mul_expr = multiplicative_expression(expr->m_rhs.get());
+        }
+        else
+        {
+            ret->m_mul_expr = multiplicative_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_multiplicative_expression> ExprExpander::multiplicative_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_multiplicative_expression>(expr);
+        if (binary_level(expr) == LV_MULTIPLICATIVE)
+        {
+            ret->m_child = multiplicative_expression(expr->m_lhs.get());
+            ret->m_child->m_op = expr->m_op;
+            ret->m_cast_expr = cast_expression(expr->m_rhs.get());
+        }
+        else
+        {
+            ret->m_cast_expr = cast_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_cast_expression> ExprExpander::cast_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_cast_expression>(expr);
+        if (expr->m_type == AST_expr::E_CAST)
+        {
+            walk(expr->m_type_name.get());
+            ret->m_type_name = expr->m_type_name;
+            ret->m_child = cast_expression(expr->m_lhs.get());
+        }
+        else
+        {
+            ret->m_unary_expr = unary_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_unary_expression> ExprExpander::unary_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_unary_expression>(expr);
+        if (expr->m_type == AST_expr::E_UNARY)
+        {
+            ret->m_op = expr->m_op;
+            if (ret->m_op == SYM_INC || ret->m_op == SYM_DEC || ret->m_op == KW_SIZEOF)
+                ret->m_child = unary_expression(expr->m_lhs.get());
+            else
+                ret->m_cast_expr = cast_expression(expr->m_lhs.get());
+        }
+        else if (expr->m_type == AST_expr::E_UNARY_TYPE)
+        {
+            walk(expr->m_type_name.get());
+            ret->m_op = expr->m_op;
+            ret->m_type_name = expr->m_type_name;
+        }
+        else
+        {
+            ret->m_postfix_expr = postfix_expression(expr);
+        }
+        return ret;
+    }
+    inline s_p<AST_postfix_expression> ExprExpander::postfix_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_postfix_expression>(expr);
+        switch (expr->m_type)
+        {
+        case AST_expr::E_COMPOUND:
+            break;
+        case AST_expr::E_INDEX:
+            ret->m_op = SYM_L_BRACKET;
+            ret->m_child = postfix_expression(expr->m_lhs.get());
+            if (expr->m_rhs)
+                ret->m_expr = expression(expr->m_rhs.get());
+            break;
+        case AST_expr::E_CALL:
+            ret->m_child = postfix_expression(expr->m_lhs.get());
+            if (expr->m_args.size())
+            {
+                ret->m_arg_expr_list = m_arena.make<AST_argument_expression_list>();
+                ret->m_arg_expr_list->m_first = expr->m_args.front()->m_first;
+                ret->m_arg_expr_list->m_last = expr->m_args.back()->m_last;
+                for (auto& arg : expr->m_args)
+                {
+                    ret->m_arg_expr_list->push_back(assignment_expression(arg.get()));
+                }
+            }
+            break;
+        case AST_expr::E_MEMBER:
+            ret->m_op = expr->m_op;
+            ret->m_child = postfix_expression(expr->m_lhs.get());
+            ret->m_ident = expr->m_ident;
+            break;
+        case AST_expr::E_POSTFIX:
+            ret->m_op = expr->m_op;
+            ret->m_child = postfix_expression(expr->m_lhs.get());
+            break;
+        default:
+            ret->m_prim_expr = primary_expression(expr);
+            break;
+        }
+        return ret;
+    }
+    inline s_p<AST_primary_expression> ExprExpander::primary_expression(AST_expr *expr)
+    {
+        auto ret = make<AST_primary_expression>(expr);
+        switch (expr->m_type)
+        {
+        case AST_expr::E_IDENT:
+            ret->m_type = AST_primary_expression::PE_IDENT;
+            ret->m_ident = expr->m_ident;
+            break;
+        case AST_expr::E_CONST:
+            ret->m_type = AST_primary_expression::PE_CONST;
+            ret->m_const = expr->m_const;
+            break;
+        case AST_expr::E_STR:
+            ret->m_type = AST_primary_expression::PE_STR;
+            ret->m_str = expr->m_str;
+            ret->m_fix = expr->m_fix;
+            break;
+        case AST_expr::E_PAREN:
+            ret->m_type = AST_primary_expression::PE_PAREN;
+            ret->m_expr = expression(expr->m_lhs.get());
+            break;
+        case AST_expr::E_GENERIC:
+            walk(expr->m_gen_sel.get());
+            ret->m_type = AST_primary_expression::PE_GEN;
+            ret->m_gen_sel = expr->m_gen_sel;
+            break;
+        default:
+            assert(0);
+            break;
+        }
+        return ret;
+    }
+} // namespace CodeReverse
+
+/////////////////////////////////////////////////////////////////////////
+
+#endif  // ndef CODEREVERSE_COMPACT_EXPR_HPP
@@ -0,0 +1,1290 @@
+// FlatAST.hpp --- CodeReverse flattened A.S.T.
+// Copyright (C) 2017 Katayama Hirofumi MZ. License: MIT License
+#ifndef CODEREVERSE_FLAT_AST_HPP
+#define CODEREVERSE_FLAT_AST_HPP
+
+#include "AST.hpp"
+#include <unordered_map>    // for std::unordered_map
+#include <cstdint>          // for uint16_t, uint32_t
+
+/////////////////////////////////////////////////////////////////////////
+
+namespace CodeReverse
+{
+    /////////////////////////////////////////////////////////////////////////
+    // FlatKind --- the kind of a flat node, one for each A.S.T. struct
+
+    enum FlatKind
+    {
+        FK_TRANSLATION_UNIT,
+        FK_EXTERNAL_DECLARATION,
+        FK_SKIPPED_DECLARATION,
+        FK_FUNCTION_DEFINITION,
+        FK_DECLARATION,
+        FK_DECLARATION_SPECIFIERS,
+        FK_DECLARATION_SPECIFIER,
+        FK_DECLARATOR,
+        FK_FUNCTION_ATTRIBUTE,
+        FK_DECLARATION_LIST,
+        FK_COMPOUND_STATEMENT,
+        FK_DECLARATION_OR_STATEMENT,
+        FK_INIT_DECLARATOR_LIST,
+        FK_INIT_DECLARATOR,
+        FK_STATIC_ASSERT_DECLARATION,
+        FK_STORAGE_CLASS_SPECIFIER,
+        FK_TYPE_SPECIFIER,
+        FK_TYPE_QUALIFIER,
+        FK_FUNCTION_SPECIFIER,
+        FK_ALIGNMENT_SPECIFIER,
+        FK_POINTER,
+        FK_DIRECT_DECLARATOR,
+        FK_IDENTIFIER_LIST,
+        FK_IDENTIFIER,
+        FK_INITIALIZER_LIST,
+        FK_DESIGNATIVE_INITIALIZER,
+        FK_INITIALIZER,
+        FK_CONSTANT_EXPRESSION,
+        FK_ATOMIC_TYPE_SPECIFIER,
+        FK_STRUCT_OR_UNION_SPECIFIER,
+        FK_STRUCT_DECLARATION_LIST,
+        FK_STRUCT_DECLARATION,
+        FK_ENUM_SPECIFIER,
+        FK_ENUMERATOR_LIST,
+        FK_ENUMERATOR,
+        FK_TYPE_NAME,
+        FK_SPECIFIER_QUALIFIER_LIST,
+        FK_SPECIFIER_QUALIFIER,
+        FK_ABSTRACT_DECLARATOR,
+        FK_DIRECT_ABSTRACT_DECLARATOR,
+        FK_STRUCT_DECLARATOR_LIST,
+        FK_TYPE_QUALIFIER_LIST,
+        FK_PARAMETER_TYPE_LIST,
+        FK_STRUCT_DECLARATOR,
+        FK_PARAMETER_LIST,
+        FK_PARAMETER_DECLARATION,
+        FK_EXPRESSION,
+        FK_ASSIGNMENT_EXPRESSION,
+        FK_CONDITIONAL_EXPRESSION,
+        FK_LOGICAL_OR_EXPRESSION,
+        FK_LOGICAL_AND_EXPRESSION,
+        FK_INCLUSIVE_OR_EXPRESSION,
+        FK_EXCLUSIVE_OR_EXPRESSION,
+        FK_AND_EXPRESSION,
+        FK_EQUALITY_EXPRESSION,
+        FK_RELATIONAL_EXPRESSION,
+        FK_SHIFT_EXPRESSION,
+        FK_ADDITIVE_EXPRESSION,
+        FK_MULTIPLICATIVE_EXPRESSION,
+        FK_CAST_EXPRESSION,
+        FK_UNARY_EXPRESSION,
+        FK_POSTFIX_EXPRESSION,
+        FK_PRIMARY_EXPRESSION,
+        FK_ARGUMENT_EXPRESSION_LIST,
+        FK_CONSTANT,
+        FK_GENERIC_SELECTION,
+        FK_GENERIC_ASSOC_LIST,
+        FK_GENERIC_ASSOCIATION,
+        FK_DESIGNATION,
+        FK_DESIGNATOR_LIST,
+        FK_DESIGNATOR,
+        FK_STATEMENT,
+        FK_LABELED_STATEMENT,
+        FK_EXPRESSION_STATEMENT,
+        FK_SELECTION_STATEMENT,
+        FK_ITERATION_STATEMENT,
+        FK_JUMP_STATEMENT,
+        FK_ASM_STATEMENT,
+        FK_EXPR,
+        FK_COUNT
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // FlatTag --- the field of the parent that a flat node stands for
+    //
+    // The tags are named after the fields, e.g. FT_DECL_SPECS for
+    // m_decl_specs. The items of a vector are FT_ITEM.
+
+    enum FlatTag
+    {
+        FT_ITEM,
+        FT_DECL,
+        FT_FUNC_DEF,
+        FT_SKIPPED,
+        FT_DECL_SPECS,
+        FT_DECLOR,
+        FT_DECL_LIST,
+        FT_COMP_STMT,
+        FT_INIT_DECLOR_LIST,
+        FT_STATIC_ASSERT_DECL,
+        FT_STO_CLASS_SPEC,
+        FT_TYPE_SPEC,
+        FT_TYPE_QUAL,
+        FT_FUNC_SPEC,
+        FT_ALIGN_SPEC,
+        FT_PTR,
+        FT_DIR_DECLOR,
+        FT_STMT,
+        FT_INIT,
+        FT_CONST_EXPR,
+        FT_ATOM_TYPE_SPEC,
+        FT_SU_SPEC,
+        FT_ENUM_SPEC,
+        FT_TYPE_NAME,
+        FT_TYPE_QUAL_LIST,
+        FT_CHILD,
+        FT_IDENT,
+        FT_ASSIGN_EXPR,
+        FT_PARAM_TYPE_LIST,
+        FT_IDENT_LIST,
+        FT_DESIGN,
+        FT_INIT_LIST,
+        FT_COND_EXPR,
+        FT_STRUCT_DECL_LIST,
+        FT_SPEC_QUAL_LIST,
+        FT_STRUCT_DECLOR_LIST,
+        FT_ENUM_LIST,
+        FT_ABST_DECLOR,
+        FT_DIR_ABST_DECLOR,
+        FT_PARAM_LIST,
+        FT_UNARY_EXPR,
+        FT_LOG_OR_EXPR,
+        FT_EXPR,
+        FT_REL_EXPR,
+        FT_SHIFT_EXPR,
+        FT_ADD_EXPR,
+        FT_MUL_EXPR,
+        FT_CAST_EXPR,
+        FT_POSTFIX_EXPR,
+        FT_PRIM_EXPR,
+        FT_ARG_EXPR_LIST,
+        FT_CONST,
+        FT_GEN_SEL,
+        FT_GEN_ASSOC_LIST,
+        FT_DESIGN_LIST,
+        FT_LABEL_STMT,
+        FT_EXPR_STMT,
+        FT_SEL_STMT,
+        FT_ITER_STMT,
+        FT_JUMP_STMT,
+        FT_ASM_STMT,
+        FT_STMT0,
+        FT_STMT1,
+        FT_EXPR0,
+        FT_EXPR1,
+        FT_EXPR2,
+        FT_COMPACT,
+        FT_LHS,
+        FT_RHS,
+        FT_THIRD,
+        FT_COUNT
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // FlatNode --- a node of the flat A.S.T.
+
+    struct FlatNode
+    {
+        uint16_t m_kind;    // FlatKind
+        uint16_t m_tag;     // FlatTag
+        uint32_t m_next;    // the index next to the subtree
+        uint32_t m_str;     // m_str or the text of m_op or m_assign_op; FlatAST::NONE if empty
+        uint32_t m_value;   // m_type, m_is_union or m_has_dots
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // FlatExtra --- the rare fields of a flat node
+
+    struct FlatExtra
+    {
+        uint32_t        m_node;     // the index of the node
+        uint32_t        m_fix;      // m_fix; FlatAST::NONE if empty
+        size_t          m_begin;    // the token range of a skipped declaration
+        size_t          m_end;      // or of a function body
+        attributes_type m_attrs;
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // FlatAST --- the A.S.T. in a vector
+    //
+    // The nodes are in preorder, so a pass over the whole tree is a loop
+    // over the vector. The children of the node i start at i + 1 and each
+    // is followed by its subtree:
+    //
+    //     for (index_type k = i + 1; k < flat[i].m_next; k = flat[k].m_next)
+    //
+    // A null field has no node. The strings are interned, and the fields
+    // that few nodes have are in the extras. The lazy function bodies are
+    // parsed by from_tree().
+
+    class FlatAST
+    {
+    public:
+        typedef uint32_t index_type;
+        enum { NONE = 0xFFFFFFFF };
+
+        FlatAST();
+
+        void from_tree(s_p<AST_translation_unit> tu);
+        void clear();
+        bool operator==(const FlatAST& other) const;
+
+        bool empty() const;
+        size_t size() const;
+        size_t bytes() const;
+        const FlatNode& operator[](index_type i) const;
+        const std::vector<FlatNode>& nodes() const;
+
+        const string_type& str(index_type i) const;
+        index_type child(index_type i, FlatTag tag) const;
+        const FlatExtra *extra(index_type i) const;
+        const string_type& string_at(index_type id) const;
+
+    protected:
+        std::vector<FlatNode>                       m_nodes;    // in preorder
+        std::vector<string_type>                    m_strings;
+        std::unordered_map<string_type, index_type> m_string_ids;
+        std::vector<FlatExtra>                      m_extras;   // in the order of m_node
+
+        index_type open(FlatKind kind, FlatTag tag);
+        void close(index_type i);
+        index_type intern(const string_type& str);
+        FlatExtra& add_extra(index_type i);
+
+        template <typename T_ITEM>
+        void add_items(AST_vector<T_ITEM>& vec);
+
+        void add(FlatTag tag, AST_translation_unit *ast);
+        void add(FlatTag tag, AST_external_declaration *ast);
+        void add(FlatTag tag, AST_skipped_declaration *ast);
+        void add(FlatTag tag, AST_function_definition *ast);
+        void add(FlatTag tag, AST_declaration *ast);
+        void add(FlatTag tag, AST_declaration_specifiers *ast);
+        void add(FlatTag tag, AST_declaration_specifier *ast);
+        void add(FlatTag tag, AST_declarator *ast);
+        void add(FlatTag tag, AST_function_attribute *ast);
+        void add(FlatTag tag, AST_declaration_list *ast);
+        void add(FlatTag tag, AST_compound_statement *ast);
+        void add(FlatTag tag, AST_declaration_or_statement *ast);
+        void add(FlatTag tag, AST_init_declarator_list *ast);
+        void add(FlatTag tag, AST_init_declarator *ast);
+        void add(FlatTag tag, AST_static_assert_declaration *ast);
+        void add(FlatTag tag, AST_storage_class_specifier *ast);
+        void add(FlatTag tag, AST_type_specifier *ast);
+        void add(FlatTag tag, AST_type_qualifier *ast);
+        void add(FlatTag tag, AST_function_specifier *ast);
+        void add(FlatTag tag, AST_alignment_specifier *ast);
+        void add(FlatTag tag, AST_pointer *ast);
+        void add(FlatTag tag, AST_direct_declarator *ast);
+        void add(FlatTag tag, AST_identifier_list *ast);
+        void add(FlatTag tag, AST_identifier *ast);
+        void add(FlatTag tag, AST_initializer_list *ast);
+        void add(FlatTag tag, AST_designative_initializer *ast);
+        void add(FlatTag tag, AST_initializer *ast);
+        void add(FlatTag tag, AST_constant_expression *ast);
+        void add(FlatTag tag, AST_atomic_type_specifier *ast);
+        void add(FlatTag tag, AST_struct_or_union_specifier *ast);
+        void add(FlatTag tag, AST_struct_declaration_list *ast);
+        void add(FlatTag tag, AST_struct_declaration *ast);
+        void add(FlatTag tag, AST_enum_specifier *ast);
+        void add(FlatTag tag, AST_enumerator_list *ast);
+        void add(FlatTag tag, AST_enumerator *ast);
+        void add(FlatTag tag, AST_type_name *ast);
+        void add(FlatTag tag, AST_specifier_qualifier_list *ast);
+        void add(FlatTag tag, AST_specifier_qualifier *ast);
+        void add(FlatTag tag, AST_abstract_declarator *ast);
+        void add(FlatTag tag, AST_direct_abstract_declarator *ast);
+        void add(FlatTag tag, AST_struct_declarator_list *ast);
+        void add(FlatTag tag, AST_type_qualifier_list *ast);
+        void add(FlatTag tag, AST_parameter_type_list *ast);
+        void add(FlatTag tag, AST_struct_declarator *ast);
+        void add(FlatTag tag, AST_parameter_list *ast);
+        void add(FlatTag tag, AST_parameter_declaration *ast);
+        void add(FlatTag tag, AST_expression *ast);
+        void add(FlatTag tag, AST_assignment_expression *ast);
+        void add(FlatTag tag, AST_conditional_expression *ast);
+        void add(FlatTag tag, AST_logical_or_expression *ast);
+        void add(FlatTag tag, AST_logical_and_expression *ast);
+        void add(FlatTag tag, AST_inclusive_or_expression *ast);
+        void add(FlatTag tag, AST_exclusive_or_expression *ast);
+        void add(FlatTag tag, AST_and_expression *ast);
+        void add(FlatTag tag, AST_equality_expression *ast);
+        void add(FlatTag tag, AST_relational_expression *ast);
+        void add(FlatTag tag, AST_shift_expression *ast);
+        void add(FlatTag tag, AST_additive_expression *ast);
+        void add(FlatTag tag, AST_multiplicative_expression *ast);
+        void add(FlatTag tag, AST_cast_expression *ast);
+        void add(FlatTag tag, AST_unary_expression *ast);
+        void add(FlatTag tag, AST_postfix_expression *ast);
+        void add(FlatTag tag, AST_primary_expression *ast);
+        void add(FlatTag tag, AST_argument_expression_list *ast);
+        void add(FlatTag tag, AST_constant *ast);
+        void add(FlatTag tag, AST_generic_selection *ast);
+        void add(FlatTag tag, AST_generic_assoc_list *ast);
+        void add(FlatTag tag, AST_generic_association *ast);
+        void add(FlatTag tag, AST_designation *ast);
+        void add(FlatTag tag, AST_designator_list *ast);
+        void add(FlatTag tag, AST_designator *ast);
+        void add(FlatTag tag, AST_statement *ast);
+        void add(FlatTag tag, AST_labeled_statement *ast);
+        void add(FlatTag tag, AST_expression_statement *ast);
+        void add(FlatTag tag, AST_selection_statement *ast);
+        void add(FlatTag tag, AST_iteration_statement *ast);
+        void add(FlatTag tag, AST_jump_statement *ast);
+        void add(FlatTag tag, AST_asm_statement *ast);
+        void add(FlatTag tag, AST_expr *ast);
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // FlatAST inlines
+
+    inline FlatAST::FlatAST()
+    {
+    }
+    inline void FlatAST::from_tree(s_p<AST_translation_unit> tu)
+    {
+        clear();
+        add(FT_ITEM, tu.get());
+        m_nodes.shrink_to_fit();
+        m_extras.shrink_to_fit();
+    }
+    inline void FlatAST::clear()
+    {
+        m_nodes.clear();
+        m_strings.clear();
+        m_string_ids.clear();
+        m_extras.clear();
+    }
+    // the same nodes with the same strings and extras, that is, the trees
+    // were the same
+    inline bool FlatAST::operator==(const FlatAST& other) const
+    {
+        if (m_nodes.size() != other.m_nodes.size() ||
+            m_strings != other.m_strings ||
+            m_extras.size() != other.m_extras.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < m_nodes.size(); ++i)
+        {
+            const FlatNode& a = m_nodes[i];
+            const FlatNode& b = other.m_nodes[i];
+            if (a.m_kind != b.m_kind || a.m_tag != b.m_tag ||
+                a.m_next != b.m_next || a.m_str != b.m_str ||
+                a.m_value != b.m_value)
+            {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < m_extras.size(); ++i)
+        {
+            const FlatExtra& a = m_extras[i];
+            const FlatExtra& b = other.m_extras[i];
+            if (a.m_node != b.m_node || a.m_fix != b.m_fix ||
+                a.m_begin != b.m_begin || a.m_end != b.m_end ||
+                a.m_attrs != b.m_attrs)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    inline bool FlatAST::empty() const
+    {
+        return m_nodes.empty();
+    }
+    inline size_t FlatAST::size() const
+    {
+        return m_nodes.size();
+    }
+    inline size_t FlatAST::bytes() const
+    {
+        size_t ret = m_nodes.capacity() * sizeof(FlatNode);
+        ret += m_extras.capacity() * sizeof(FlatExtra);
+        for (auto& str : m_strings)
+        {
+            ret += sizeof(string_type) + str.capacity();
+        }
+        return ret;
+    }
+    inline const FlatNode& FlatAST::operator[](index_type i) const
+    {
+        assert(i < m_nodes.size());
+        return m_nodes[i];
+    }
+    inline const std::vector<FlatNode>& FlatAST::nodes() const
+    {
+        return m_nodes;
+    }
+    inline const string_type& FlatAST::str(index_type i) const
+    {
+        return string_at(m_nodes[i].m_str);
+    }
+    inline const string_type& FlatAST::string_at(index_type id) const
+    {
+        static const string_type s_empty;
+        if (id == NONE)
+            return s_empty;
+        return m_strings[id];
+    }
+    inline FlatAST::index_type FlatAST::child(index_type i, FlatTag tag) const
+    {
+        for (index_type k = i + 1; k < m_nodes[i].m_next; k = m_nodes[k].m_next)
+        {
+            if (m_nodes[k].m_tag == tag)
+                return k;
+        }
+        return NONE;
+    }
+    inline const FlatExtra *FlatAST::extra(index_type i) const
+    {
+        auto it = std::lower_bound(m_extras.begin(), m_extras.end(), i,
+            [](const FlatExtra& extra, index_type i) {
+                return extra.m_node < i;
+            });
+        if (it != m_extras.end() && it->m_node == i)
+            return &*it;
+        return NULL;
+    }
+
+    inline FlatAST::index_type FlatAST::open(FlatKind kind, FlatTag tag)
+    {
+        assert(m_nodes.size() < NONE);
+        FlatNode node;
+        node.m_kind = uint16_t(kind);
+        node.m_tag = uint16_t(tag);
+        node.m_next = NONE;
+        node.m_str = NONE;
+        node.m_value = 0;
+        m_nodes.push_back(node);
+        return index_type(m_nodes.size() - 1);
+    }
+    inline void FlatAST::close(index_type i)
+    {
+        m_nodes[i].m_next = index_type(m_nodes.size());
+    }
+    inline FlatAST::index_type FlatAST::intern(const string_type& str)
+    {
+        if (str.empty())
+            return NONE;
+
+        auto it = m_string_ids.find(str);
+        if (it != m_string_ids.end())
+            return it->second;
+
+        index_type id = index_type(m_strings.size());
+        m_strings.push_back(str);
+        m_string_ids[str] = id;
+        return id;
+    }
+    inline FlatExtra& FlatAST::add_extra(index_type i)
+    {
+        if (m_extras.empty() || m_extras.back().m_node != i)
+        {
+            assert(m_extras.empty() || m_extras.back().m_node < i);
+            FlatExtra extra;
+            extra.m_node = i;
+            extra.m_fix = NONE;
+            extra.m_begin = extra.m_end = 0;
+            m_extras.push_back(extra);
+        }
+        return m_extras.back();
+    }
+
+    template <typename T_ITEM>
+    inline void FlatAST::add_items(AST_vector<T_ITEM>& vec)
+    {
+        for (auto& item : vec.m_vec)
+        {
+            add(FT_ITEM, item.get());
+        }
+    }
+
+    inline void FlatAST::add(FlatTag tag, AST_translation_unit *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_TRANSLATION_UNIT, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_external_declaration *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_EXTERNAL_DECLARATION, tag);
+        add(FT_DECL, ast->m_decl.get());
+        add(FT_FUNC_DEF, ast->m_func_def.get());
+        add(FT_SKIPPED, ast->m_skipped.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_skipped_declaration *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_SKIPPED_DECLARATION, tag);
+        FlatExtra& extra = add_extra(i);
+        extra.m_begin = ast->m_begin;
+        extra.m_end = ast->m_end;
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_function_definition *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_FUNCTION_DEFINITION, tag);
+        FlatExtra& extra = add_extra(i);
+        extra.m_begin = ast->m_body_begin;
+        extra.m_end = ast->m_body_end;
+        extra.m_attrs = ast->m_attrs;
+        add(FT_DECL_SPECS, ast->m_decl_specs.get());
+        add(FT_DECLOR, ast->m_declor.get());
+        add(FT_DECL_LIST, ast->m_decl_list.get());
+        add(FT_COMP_STMT, ast->comp_stmt().get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_declaration *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DECLARATION, tag);
+        if (ast->m_attrs.size())
+            add_extra(i).m_attrs = ast->m_attrs;
+        add(FT_DECL_SPECS, ast->m_decl_specs.get());
+        add(FT_INIT_DECLOR_LIST, ast->m_init_declor_list.get());
+        add(FT_STATIC_ASSERT_DECL, ast->m_static_assert_decl.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_declaration_specifiers *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DECLARATION_SPECIFIERS, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_declaration_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DECLARATION_SPECIFIER, tag);
+        m_nodes[i].m_value = ast->m_type;
+        add(FT_STO_CLASS_SPEC, ast->m_sto_class_spec.get());
+        add(FT_TYPE_SPEC, ast->m_type_spec.get());
+        add(FT_TYPE_QUAL, ast->m_type_qual.get());
+        add(FT_FUNC_SPEC, ast->m_func_spec.get());
+        add(FT_ALIGN_SPEC, ast->m_align_spec.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_declarator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DECLARATOR, tag);
+        if (ast->m_attrs.size())
+            add_extra(i).m_attrs = ast->m_attrs;
+        add(FT_PTR, ast->m_ptr.get());
+        add(FT_DIR_DECLOR, ast->m_dir_declor.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_function_attribute *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_FUNCTION_ATTRIBUTE, tag);
+        m_nodes[i].m_str = intern(ast->m_str);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_declaration_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DECLARATION_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_compound_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_COMPOUND_STATEMENT, tag);
+        add_items(ast->m_items);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_declaration_or_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DECLARATION_OR_STATEMENT, tag);
+        add(FT_DECL, ast->m_decl.get());
+        add(FT_STMT, ast->m_stmt.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_init_declarator_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_INIT_DECLARATOR_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_init_declarator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_INIT_DECLARATOR, tag);
+        add(FT_DECLOR, ast->m_declor.get());
+        add(FT_INIT, ast->m_init.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_static_assert_declaration *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STATIC_ASSERT_DECLARATION, tag);
+        m_nodes[i].m_str = intern(ast->m_str);
+        add(FT_CONST_EXPR, ast->m_const_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_storage_class_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STORAGE_CLASS_SPECIFIER, tag);
+        m_nodes[i].m_str = intern(ast->m_str);
+        if (ast->m_attrs.size())
+            add_extra(i).m_attrs = ast->m_attrs;
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_type_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_TYPE_SPECIFIER, tag);
+        m_nodes[i].m_value = ast->m_type;
+        m_nodes[i].m_str = intern(ast->m_str);
+        add(FT_ATOM_TYPE_SPEC, ast->m_atom_type_spec.get());
+        add(FT_SU_SPEC, ast->m_su_spec.get());
+        add(FT_ENUM_SPEC, ast->m_enum_spec.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_type_qualifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_TYPE_QUALIFIER, tag);
+        m_nodes[i].m_str = intern(ast->m_str);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_function_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_FUNCTION_SPECIFIER, tag);
+        if (ast->m_attrs.size())
+            add_extra(i).m_attrs = ast->m_attrs;
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_alignment_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ALIGNMENT_SPECIFIER, tag);
+        add(FT_TYPE_NAME, ast->m_type_name.get());
+        add(FT_CONST_EXPR, ast->m_const_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_pointer *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_POINTER, tag);
+        add(FT_TYPE_QUAL_LIST, ast->m_type_qual_list.get());
+        add(FT_CHILD, ast->m_child.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_direct_declarator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DIRECT_DECLARATOR, tag);
+        m_nodes[i].m_value = ast->m_type;
+        m_nodes[i].m_str = intern(ast->m_str);
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_DECLOR, ast->m_declor.get());
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_TYPE_QUAL_LIST, ast->m_type_qual_list.get());
+        add(FT_ASSIGN_EXPR, ast->m_assign_expr.get());
+        add(FT_PARAM_TYPE_LIST, ast->m_param_type_list.get());
+        add(FT_IDENT_LIST, ast->m_ident_list.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_identifier_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_IDENTIFIER_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_identifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_IDENTIFIER, tag);
+        m_nodes[i].m_str = intern(ast->m_str);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_initializer_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_INITIALIZER_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_designative_initializer *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DESIGNATIVE_INITIALIZER, tag);
+        add(FT_DESIGN, ast->m_design.get());
+        add(FT_INIT, ast->m_init.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_initializer *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_INITIALIZER, tag);
+        add(FT_INIT_LIST, ast->m_init_list.get());
+        add(FT_ASSIGN_EXPR, ast->m_assign_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_constant_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_CONSTANT_EXPRESSION, tag);
+        add(FT_COND_EXPR, ast->m_cond_expr.get());
+        add(FT_COMPACT, ast->m_compact.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_atomic_type_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ATOMIC_TYPE_SPECIFIER, tag);
+        add(FT_TYPE_NAME, ast->m_type_name.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_struct_or_union_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STRUCT_OR_UNION_SPECIFIER, tag);
+        m_nodes[i].m_value = ast->m_is_union;
+        if (ast->m_attrs.size())
+            add_extra(i).m_attrs = ast->m_attrs;
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_STRUCT_DECL_LIST, ast->m_struct_decl_list.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_struct_declaration_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STRUCT_DECLARATION_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_struct_declaration *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STRUCT_DECLARATION, tag);
+        if (ast->m_attrs.size())
+            add_extra(i).m_attrs = ast->m_attrs;
+        add(FT_SPEC_QUAL_LIST, ast->m_spec_qual_list.get());
+        add(FT_STRUCT_DECLOR_LIST, ast->m_struct_declor_list.get());
+        add(FT_STATIC_ASSERT_DECL, ast->m_static_assert_decl.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_enum_specifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ENUM_SPECIFIER, tag);
+        add(FT_ENUM_LIST, ast->m_enum_list.get());
+        add(FT_IDENT, ast->m_ident.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_enumerator_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ENUMERATOR_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_enumerator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ENUMERATOR, tag);
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_CONST_EXPR, ast->m_const_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_type_name *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_TYPE_NAME, tag);
+        add(FT_SPEC_QUAL_LIST, ast->m_spec_qual_list.get());
+        add(FT_ABST_DECLOR, ast->m_abst_declor.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_specifier_qualifier_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_SPECIFIER_QUALIFIER_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_specifier_qualifier *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_SPECIFIER_QUALIFIER, tag);
+        add(FT_TYPE_SPEC, ast->m_type_spec.get());
+        add(FT_TYPE_QUAL, ast->m_type_qual.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_abstract_declarator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ABSTRACT_DECLARATOR, tag);
+        if (ast->m_attrs.size())
+            add_extra(i).m_attrs = ast->m_attrs;
+        add(FT_PTR, ast->m_ptr.get());
+        add(FT_DIR_ABST_DECLOR, ast->m_dir_abst_declor.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_direct_abstract_declarator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DIRECT_ABSTRACT_DECLARATOR, tag);
+        m_nodes[i].m_str = intern(ast->m_str);
+        add(FT_ABST_DECLOR, ast->m_abst_declor.get());
+        add(FT_PARAM_TYPE_LIST, ast->m_param_type_list.get());
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_TYPE_QUAL_LIST, ast->m_type_qual_list.get());
+        add(FT_ASSIGN_EXPR, ast->m_assign_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_struct_declarator_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STRUCT_DECLARATOR_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_type_qualifier_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_TYPE_QUALIFIER_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_parameter_type_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_PARAMETER_TYPE_LIST, tag);
+        m_nodes[i].m_value = ast->m_has_dots;
+        add(FT_PARAM_LIST, ast->m_param_list.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_struct_declarator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STRUCT_DECLARATOR, tag);
+        add(FT_CONST_EXPR, ast->m_const_expr.get());
+        add(FT_DECLOR, ast->m_declor.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_parameter_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_PARAMETER_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_parameter_declaration *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_PARAMETER_DECLARATION, tag);
+        add(FT_DECL_SPECS, ast->m_decl_specs.get());
+        add(FT_DECLOR, ast->m_declor.get());
+        add(FT_ABST_DECLOR, ast->m_abst_declor.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_EXPRESSION, tag);
+        add_items(*ast);
+        add(FT_COMPACT, ast->m_compact.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_assignment_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ASSIGNMENT_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_assign_op));
+        add(FT_COND_EXPR, ast->m_cond_expr.get());
+        add(FT_UNARY_EXPR, ast->m_unary_expr.get());
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_COMPACT, ast->m_compact.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_conditional_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_CONDITIONAL_EXPRESSION, tag);
+        add(FT_LOG_OR_EXPR, ast->m_log_or_expr.get());
+        add(FT_EXPR, ast->m_expr.get());
+        add(FT_CHILD, ast->m_child.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_logical_or_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_LOGICAL_OR_EXPRESSION, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_logical_and_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_LOGICAL_AND_EXPRESSION, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_inclusive_or_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_INCLUSIVE_OR_EXPRESSION, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_exclusive_or_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_EXCLUSIVE_OR_EXPRESSION, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_and_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_AND_EXPRESSION, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_equality_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_EQUALITY_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_REL_EXPR, ast->m_rel_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_relational_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_RELATIONAL_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_SHIFT_EXPR, ast->m_shift_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_shift_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_SHIFT_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_ADD_EXPR, ast->m_add_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_additive_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ADDITIVE_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_MUL_EXPR, ast->m_mul_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_multiplicative_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_MULTIPLICATIVE_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_CAST_EXPR, ast->m_cast_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_cast_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_CAST_EXPRESSION, tag);
+        add(FT_UNARY_EXPR, ast->m_unary_expr.get());
+        add(FT_TYPE_NAME, ast->m_type_name.get());
+        add(FT_CHILD, ast->m_child.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_unary_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_UNARY_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        add(FT_POSTFIX_EXPR, ast->m_postfix_expr.get());
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_CAST_EXPR, ast->m_cast_expr.get());
+        add(FT_TYPE_NAME, ast->m_type_name.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_postfix_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_POSTFIX_EXPRESSION, tag);
+        m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        add(FT_PRIM_EXPR, ast->m_prim_expr.get());
+        add(FT_CHILD, ast->m_child.get());
+        add(FT_EXPR, ast->m_expr.get());
+        add(FT_ARG_EXPR_LIST, ast->m_arg_expr_list.get());
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_TYPE_NAME, ast->m_type_name.get());
+        add(FT_INIT_LIST, ast->m_init_list.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_primary_expression *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_PRIMARY_EXPRESSION, tag);
+        m_nodes[i].m_value = ast->m_type;
+        m_nodes[i].m_str = intern(ast->m_str);
+        if (ast->m_fix.size())
+            add_extra(i).m_fix = intern(ast->m_fix);
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_CONST, ast->m_const.get());
+        add(FT_EXPR, ast->m_expr.get());
+        add(FT_GEN_SEL, ast->m_gen_sel.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_argument_expression_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ARGUMENT_EXPRESSION_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_constant *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_CONSTANT, tag);
+        m_nodes[i].m_value = ast->m_type;
+        m_nodes[i].m_str = intern(ast->m_str);
+        if (ast->m_fix.size())
+            add_extra(i).m_fix = intern(ast->m_fix);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_generic_selection *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_GENERIC_SELECTION, tag);
+        add(FT_ASSIGN_EXPR, ast->m_assign_expr.get());
+        add(FT_GEN_ASSOC_LIST, ast->m_gen_assoc_list.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_generic_assoc_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_GENERIC_ASSOC_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_generic_association *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_GENERIC_ASSOCIATION, tag);
+        add(FT_ASSIGN_EXPR, ast->m_assign_expr.get());
+        add(FT_TYPE_NAME, ast->m_type_name.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_designation *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DESIGNATION, tag);
+        add(FT_DESIGN_LIST, ast->m_design_list.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_designator_list *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DESIGNATOR_LIST, tag);
+        add_items(*ast);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_designator *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_DESIGNATOR, tag);
+        add(FT_CONST_EXPR, ast->m_const_expr.get());
+        add(FT_IDENT, ast->m_ident.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_STATEMENT, tag);
+        m_nodes[i].m_value = ast->m_type;
+        add(FT_LABEL_STMT, ast->m_label_stmt.get());
+        add(FT_COMP_STMT, ast->m_comp_stmt.get());
+        add(FT_EXPR_STMT, ast->m_expr_stmt.get());
+        add(FT_SEL_STMT, ast->m_sel_stmt.get());
+        add(FT_ITER_STMT, ast->m_iter_stmt.get());
+        add(FT_JUMP_STMT, ast->m_jump_stmt.get());
+        add(FT_ASM_STMT, ast->m_asm_stmt.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_labeled_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_LABELED_STATEMENT, tag);
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_CONST_EXPR, ast->m_const_expr.get());
+        add(FT_STMT, ast->m_stmt.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_expression_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_EXPRESSION_STATEMENT, tag);
+        add(FT_EXPR, ast->m_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_selection_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_SELECTION_STATEMENT, tag);
+        m_nodes[i].m_value = ast->m_type;
+        add(FT_EXPR, ast->m_expr.get());
+        add(FT_STMT0, ast->m_stmt0.get());
+        add(FT_STMT1, ast->m_stmt1.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_iteration_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ITERATION_STATEMENT, tag);
+        m_nodes[i].m_value = ast->m_type;
+        add(FT_EXPR0, ast->m_expr0.get());
+        add(FT_EXPR1, ast->m_expr1.get());
+        add(FT_EXPR2, ast->m_expr2.get());
+        add(FT_DECL, ast->m_decl.get());
+        add(FT_STMT, ast->m_stmt.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_jump_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_JUMP_STATEMENT, tag);
+        m_nodes[i].m_value = ast->m_type;
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_EXPR, ast->m_expr.get());
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_asm_statement *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_ASM_STATEMENT, tag);
+        close(i);
+    }
+    inline void FlatAST::add(FlatTag tag, AST_expr *ast)
+    {
+        if (!ast)
+            return;
+        index_type i = open(FK_EXPR, tag);
+        m_nodes[i].m_value = ast->m_type;
+        if (ast->m_type == AST_expr::E_STR)
+        {
+            m_nodes[i].m_str = intern(ast->m_str);
+            if (ast->m_fix.size())
+                add_extra(i).m_fix = intern(ast->m_fix);
+        }
+        else
+        {
+            m_nodes[i].m_str = intern(token_id_str(ast->m_op));
+        }
+        add(FT_LHS, ast->m_lhs.get());
+        add(FT_RHS, ast->m_rhs.get());
+        add(FT_THIRD, ast->m_third.get());
+        for (auto& arg : ast->m_args)
+        {
+            add(FT_ITEM, arg.get());
+        }
+        add(FT_IDENT, ast->m_ident.get());
+        add(FT_CONST, ast->m_const.get());
+        add(FT_TYPE_NAME, ast->m_type_name.get());
+        add(FT_GEN_SEL, ast->m_gen_sel.get());
+        close(i);
+    }
+} // namespace CodeReverse
+
+/////////////////////////////////////////////////////////////////////////
+
+#endif  // ndef CODEREVERSE_FLAT_AST_HPP
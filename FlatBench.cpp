@@ -0,0 +1,995 @@
+// FlatBench.cpp --- checks the flat A.S.T. and the spans against the tree,
+//                   and times a pass over each form
+// Copyright (C) 2017 Katayama Hirofumi MZ. License: MIT License
+#include "CParser.hpp"
+#include "FlatAST.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+
+using namespace CodeReverse;
+
+/////////////////////////////////////////////////////////////////////////
+// visitors: visit(ast, kind, depth, str) for each node in preorder, where
+// str is m_str or the text of m_op or m_assign_op as in FlatNode; ast is
+// NULL for a flat node
+
+// the shape and the strings of the tree, to compare the two forms
+struct Digest
+{
+    uint64_t    m_hash;         // of the (kind, depth) sequence
+    size_t      m_nodes;
+    size_t      m_str_bytes;
+    size_t      m_kinds[FK_COUNT];
+
+    Digest() : m_hash(0), m_nodes(0), m_str_bytes(0)
+    {
+        std::fill(m_kinds, m_kinds + FK_COUNT, 0);
+    }
+    void visit(const AST_base *, int kind, int depth, const string_type& str)
+    {
+        m_hash = m_hash * 1000003 + kind * 131 + depth;
+        ++m_nodes;
+        m_str_bytes += str.size();
+        ++m_kinds[kind];
+    }
+    bool operator==(const Digest& other) const
+    {
+        return m_hash == other.m_hash && m_nodes == other.m_nodes &&
+               m_str_bytes == other.m_str_bytes &&
+               std::equal(m_kinds, m_kinds + FK_COUNT, other.m_kinds);
+    }
+};
+
+// the pass that is timed: the identifiers and the bytes of the strings
+struct Counter
+{
+    size_t      m_idents;
+    size_t      m_str_bytes;
+
+    Counter() : m_idents(0), m_str_bytes(0)
+    {
+    }
+    void visit(const AST_base *, int kind, int, const string_type& str)
+    {
+        if (kind == FK_IDENTIFIER)
+            ++m_idents;
+        m_str_bytes += str.size();
+    }
+};
+
+// every node has tokens, and they lie within the tokens of its parent
+struct SpanCheck
+{
+    std::vector<const AST_base *>   m_parents;  // by depth
+    size_t                          m_nodes;
+    size_t                          m_errors;
+
+    SpanCheck() : m_nodes(0), m_errors(0)
+    {
+    }
+    void visit(const AST_base *ast, int kind, int depth, const string_type&)
+    {
+        m_parents.resize(depth);
+        const AST_base *parent = (depth ? m_parents.back() : NULL);
+        ++m_nodes;
+        if (ast->m_first >= ast->m_last ||
+            (parent && (ast->m_first < parent->m_first ||
+                        parent->m_last < ast->m_last)))
+        {
+            if (m_errors++ < 10)
+            {
+                std::cerr << "span: node of kind " << kind << " at depth " <<
+                    depth << " has [" << ast->m_first << ", " << ast->m_last << ")";
+                if (parent)
+                {
+                    std::cerr << " in [" << parent->m_first << ", " <<
+                        parent->m_last << ")";
+                }
+                std::cerr << "\n";
+            }
+        }
+        m_parents.push_back(ast);
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////
+// the tree: every field of every A.S.T. struct, in the order of
+// FlatAST::add(). The lazy bodies are parsed by comp_stmt().
+
+template <typename T_VISITOR, typename T_ITEM>
+void walk_items(T_VISITOR& v, const std::vector<s_p<T_ITEM> >& items, int depth)
+{
+    for (auto& item : items)
+    {
+        walk(v, item.get(), depth);
+    }
+}
+
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_translation_unit *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_TRANSLATION_UNIT, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_external_declaration *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_EXTERNAL_DECLARATION, depth, string_type());
+    walk(v, ast->m_decl.get(), depth + 1);
+    walk(v, ast->m_func_def.get(), depth + 1);
+    walk(v, ast->m_skipped.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_skipped_declaration *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_SKIPPED_DECLARATION, depth, string_type());
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_function_definition *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_FUNCTION_DEFINITION, depth, string_type());
+    walk(v, ast->m_decl_specs.get(), depth + 1);
+    walk(v, ast->m_declor.get(), depth + 1);
+    walk(v, ast->m_decl_list.get(), depth + 1);
+    walk(v, ast->comp_stmt().get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_declaration *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DECLARATION, depth, string_type());
+    walk(v, ast->m_decl_specs.get(), depth + 1);
+    walk(v, ast->m_init_declor_list.get(), depth + 1);
+    walk(v, ast->m_static_assert_decl.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_declaration_specifiers *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DECLARATION_SPECIFIERS, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_declaration_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DECLARATION_SPECIFIER, depth, string_type());
+    walk(v, ast->m_sto_class_spec.get(), depth + 1);
+    walk(v, ast->m_type_spec.get(), depth + 1);
+    walk(v, ast->m_type_qual.get(), depth + 1);
+    walk(v, ast->m_func_spec.get(), depth + 1);
+    walk(v, ast->m_align_spec.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_declarator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DECLARATOR, depth, string_type());
+    walk(v, ast->m_ptr.get(), depth + 1);
+    walk(v, ast->m_dir_declor.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_function_attribute *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_FUNCTION_ATTRIBUTE, depth, ast->m_str);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_declaration_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DECLARATION_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_compound_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_COMPOUND_STATEMENT, depth, string_type());
+    walk_items(v, ast->m_items.m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_declaration_or_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DECLARATION_OR_STATEMENT, depth, string_type());
+    walk(v, ast->m_decl.get(), depth + 1);
+    walk(v, ast->m_stmt.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_init_declarator_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_INIT_DECLARATOR_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_init_declarator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_INIT_DECLARATOR, depth, string_type());
+    walk(v, ast->m_declor.get(), depth + 1);
+    walk(v, ast->m_init.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_static_assert_declaration *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STATIC_ASSERT_DECLARATION, depth, ast->m_str);
+    walk(v, ast->m_const_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_storage_class_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STORAGE_CLASS_SPECIFIER, depth, ast->m_str);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_type_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_TYPE_SPECIFIER, depth, ast->m_str);
+    walk(v, ast->m_atom_type_spec.get(), depth + 1);
+    walk(v, ast->m_su_spec.get(), depth + 1);
+    walk(v, ast->m_enum_spec.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_type_qualifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_TYPE_QUALIFIER, depth, ast->m_str);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_function_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_FUNCTION_SPECIFIER, depth, string_type());
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_alignment_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ALIGNMENT_SPECIFIER, depth, string_type());
+    walk(v, ast->m_type_name.get(), depth + 1);
+    walk(v, ast->m_const_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_pointer *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_POINTER, depth, string_type());
+    walk(v, ast->m_type_qual_list.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_direct_declarator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DIRECT_DECLARATOR, depth, ast->m_str);
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_declor.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_type_qual_list.get(), depth + 1);
+    walk(v, ast->m_assign_expr.get(), depth + 1);
+    walk(v, ast->m_param_type_list.get(), depth + 1);
+    walk(v, ast->m_ident_list.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_identifier_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_IDENTIFIER_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_identifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_IDENTIFIER, depth, ast->m_str);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_initializer_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_INITIALIZER_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_designative_initializer *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DESIGNATIVE_INITIALIZER, depth, string_type());
+    walk(v, ast->m_design.get(), depth + 1);
+    walk(v, ast->m_init.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_initializer *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_INITIALIZER, depth, string_type());
+    walk(v, ast->m_init_list.get(), depth + 1);
+    walk(v, ast->m_assign_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_constant_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_CONSTANT_EXPRESSION, depth, string_type());
+    walk(v, ast->m_cond_expr.get(), depth + 1);
+    walk(v, ast->m_compact.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_atomic_type_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ATOMIC_TYPE_SPECIFIER, depth, string_type());
+    walk(v, ast->m_type_name.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_struct_or_union_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STRUCT_OR_UNION_SPECIFIER, depth, string_type());
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_struct_decl_list.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_struct_declaration_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STRUCT_DECLARATION_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_struct_declaration *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STRUCT_DECLARATION, depth, string_type());
+    walk(v, ast->m_spec_qual_list.get(), depth + 1);
+    walk(v, ast->m_struct_declor_list.get(), depth + 1);
+    walk(v, ast->m_static_assert_decl.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_enum_specifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ENUM_SPECIFIER, depth, string_type());
+    walk(v, ast->m_enum_list.get(), depth + 1);
+    walk(v, ast->m_ident.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_enumerator_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ENUMERATOR_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_enumerator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ENUMERATOR, depth, string_type());
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_const_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_type_name *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_TYPE_NAME, depth, string_type());
+    walk(v, ast->m_spec_qual_list.get(), depth + 1);
+    walk(v, ast->m_abst_declor.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_specifier_qualifier_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_SPECIFIER_QUALIFIER_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_specifier_qualifier *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_SPECIFIER_QUALIFIER, depth, string_type());
+    walk(v, ast->m_type_spec.get(), depth + 1);
+    walk(v, ast->m_type_qual.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_abstract_declarator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ABSTRACT_DECLARATOR, depth, string_type());
+    walk(v, ast->m_ptr.get(), depth + 1);
+    walk(v, ast->m_dir_abst_declor.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_direct_abstract_declarator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DIRECT_ABSTRACT_DECLARATOR, depth, ast->m_str);
+    walk(v, ast->m_abst_declor.get(), depth + 1);
+    walk(v, ast->m_param_type_list.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_type_qual_list.get(), depth + 1);
+    walk(v, ast->m_assign_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_struct_declarator_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STRUCT_DECLARATOR_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_type_qualifier_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_TYPE_QUALIFIER_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_parameter_type_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_PARAMETER_TYPE_LIST, depth, string_type());
+    walk(v, ast->m_param_list.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_struct_declarator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STRUCT_DECLARATOR, depth, string_type());
+    walk(v, ast->m_const_expr.get(), depth + 1);
+    walk(v, ast->m_declor.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_parameter_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_PARAMETER_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_parameter_declaration *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_PARAMETER_DECLARATION, depth, string_type());
+    walk(v, ast->m_decl_specs.get(), depth + 1);
+    walk(v, ast->m_declor.get(), depth + 1);
+    walk(v, ast->m_abst_declor.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_EXPRESSION, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+    walk(v, ast->m_compact.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_assignment_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ASSIGNMENT_EXPRESSION, depth, token_id_str(ast->m_assign_op));
+    walk(v, ast->m_cond_expr.get(), depth + 1);
+    walk(v, ast->m_unary_expr.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_compact.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_conditional_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_CONDITIONAL_EXPRESSION, depth, string_type());
+    walk(v, ast->m_log_or_expr.get(), depth + 1);
+    walk(v, ast->m_expr.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_logical_or_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_LOGICAL_OR_EXPRESSION, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_logical_and_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_LOGICAL_AND_EXPRESSION, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_inclusive_or_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_INCLUSIVE_OR_EXPRESSION, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_exclusive_or_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_EXCLUSIVE_OR_EXPRESSION, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_and_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_AND_EXPRESSION, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_equality_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_EQUALITY_EXPRESSION, depth, token_id_str(ast->m_op));
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_rel_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_relational_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_RELATIONAL_EXPRESSION, depth, token_id_str(ast->m_op));
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_shift_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_shift_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_SHIFT_EXPRESSION, depth, token_id_str(ast->m_op));
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_add_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_additive_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ADDITIVE_EXPRESSION, depth, token_id_str(ast->m_op));
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_mul_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_multiplicative_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_MULTIPLICATIVE_EXPRESSION, depth, token_id_str(ast->m_op));
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_cast_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_cast_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_CAST_EXPRESSION, depth, string_type());
+    walk(v, ast->m_unary_expr.get(), depth + 1);
+    walk(v, ast->m_type_name.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_unary_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_UNARY_EXPRESSION, depth, token_id_str(ast->m_op));
+    walk(v, ast->m_postfix_expr.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_cast_expr.get(), depth + 1);
+    walk(v, ast->m_type_name.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_postfix_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_POSTFIX_EXPRESSION, depth, token_id_str(ast->m_op));
+    walk(v, ast->m_prim_expr.get(), depth + 1);
+    walk(v, ast->m_child.get(), depth + 1);
+    walk(v, ast->m_expr.get(), depth + 1);
+    walk(v, ast->m_arg_expr_list.get(), depth + 1);
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_type_name.get(), depth + 1);
+    walk(v, ast->m_init_list.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_primary_expression *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_PRIMARY_EXPRESSION, depth, ast->m_str);
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_const.get(), depth + 1);
+    walk(v, ast->m_expr.get(), depth + 1);
+    walk(v, ast->m_gen_sel.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_argument_expression_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ARGUMENT_EXPRESSION_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_constant *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_CONSTANT, depth, ast->m_str);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_generic_selection *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_GENERIC_SELECTION, depth, string_type());
+    walk(v, ast->m_assign_expr.get(), depth + 1);
+    walk(v, ast->m_gen_assoc_list.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_generic_assoc_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_GENERIC_ASSOC_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_generic_association *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_GENERIC_ASSOCIATION, depth, string_type());
+    walk(v, ast->m_assign_expr.get(), depth + 1);
+    walk(v, ast->m_type_name.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_designation *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DESIGNATION, depth, string_type());
+    walk(v, ast->m_design_list.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_designator_list *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DESIGNATOR_LIST, depth, string_type());
+    walk_items(v, ast->m_vec, depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_designator *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_DESIGNATOR, depth, string_type());
+    walk(v, ast->m_const_expr.get(), depth + 1);
+    walk(v, ast->m_ident.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_STATEMENT, depth, string_type());
+    walk(v, ast->m_label_stmt.get(), depth + 1);
+    walk(v, ast->m_comp_stmt.get(), depth + 1);
+    walk(v, ast->m_expr_stmt.get(), depth + 1);
+    walk(v, ast->m_sel_stmt.get(), depth + 1);
+    walk(v, ast->m_iter_stmt.get(), depth + 1);
+    walk(v, ast->m_jump_stmt.get(), depth + 1);
+    walk(v, ast->m_asm_stmt.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_labeled_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_LABELED_STATEMENT, depth, string_type());
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_const_expr.get(), depth + 1);
+    walk(v, ast->m_stmt.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_expression_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_EXPRESSION_STATEMENT, depth, string_type());
+    walk(v, ast->m_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_selection_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_SELECTION_STATEMENT, depth, string_type());
+    walk(v, ast->m_expr.get(), depth + 1);
+    walk(v, ast->m_stmt0.get(), depth + 1);
+    walk(v, ast->m_stmt1.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_iteration_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ITERATION_STATEMENT, depth, string_type());
+    walk(v, ast->m_expr0.get(), depth + 1);
+    walk(v, ast->m_expr1.get(), depth + 1);
+    walk(v, ast->m_expr2.get(), depth + 1);
+    walk(v, ast->m_decl.get(), depth + 1);
+    walk(v, ast->m_stmt.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_jump_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_JUMP_STATEMENT, depth, string_type());
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_expr.get(), depth + 1);
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_asm_statement *ast, int depth)
+{
+    if (!ast)
+        return;
+    v.visit(ast, FK_ASM_STATEMENT, depth, string_type());
+}
+template <typename T_VISITOR>
+void walk(T_VISITOR& v, AST_expr *ast, int depth)
+{
+    if (!ast)
+        return;
+    const string_type& str = (ast->m_type == AST_expr::E_STR ?
+                              ast->m_str : token_id_str(ast->m_op));
+    v.visit(ast, FK_EXPR, depth, str);
+    walk(v, ast->m_lhs.get(), depth + 1);
+    walk(v, ast->m_rhs.get(), depth + 1);
+    walk(v, ast->m_third.get(), depth + 1);
+    walk_items(v, ast->m_args, depth + 1);
+    walk(v, ast->m_ident.get(), depth + 1);
+    walk(v, ast->m_const.get(), depth + 1);
+    walk(v, ast->m_type_name.get(), depth + 1);
+    walk(v, ast->m_gen_sel.get(), depth + 1);
+}
+
+/////////////////////////////////////////////////////////////////////////
+// the flat form
+
+void walk_flat(Digest& v, const FlatAST& flat, FlatAST::index_type i, int depth)
+{
+    v.visit(NULL, flat[i].m_kind, depth, flat.str(i));
+    for (FlatAST::index_type k = i + 1; k < flat[i].m_next; k = flat[k].m_next)
+    {
+        walk_flat(v, flat, k, depth + 1);
+    }
+}
+
+// a pass over the whole flat form is a loop
+void count_flat(Counter& v, const FlatAST& flat)
+{
+    for (auto& node : flat.nodes())
+    {
+        if (node.m_kind == FK_IDENTIFIER)
+            ++v.m_idents;
+        if (node.m_str != FlatAST::NONE)
+            v.m_str_bytes += flat.string_at(node.m_str).size();
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+enum Mode
+{
+    MODE_PLAIN, MODE_COMPACT, MODE_LAZY
+};
+
+const char *mode_name(Mode mode)
+{
+    switch (mode)
+    {
+    case MODE_PLAIN:    return "plain";
+    case MODE_COMPACT:  return "compact";
+    case MODE_LAZY:     return "lazy";
+    }
+    return "";
+}
+
+// parses the text, converts the tree, compares the two forms and checks
+// the spans of the tree; then
+// times a whole pass over each 'repeat' times if repeat is not zero
+bool check_and_time(const string_type& str, Mode mode, size_t repeat)
+{
+    TextScanner text(str);
+    AuxInfo aux;
+    Lexer lexer(text, aux);
+    if (!lexer.do_lex())
+    {
+        std::cerr << "lexing failed\n";
+        return false;
+    }
+    lexer.fixup();
+
+    CParser parser(lexer);
+    parser.compact(mode == MODE_COMPACT);
+    parser.lazy(mode == MODE_LAZY);
+    auto tu = parser.do_parse() ? parser.ast() : nullptr;
+    if (!tu)
+    {
+        os_type os;
+        aux.err_out(os);
+        std::cerr << os.str() << "parsing failed\n";
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    FlatAST flat;
+    flat.from_tree(tu);
+    double convert_time = seconds_since(start);
+
+    Digest tree_digest, flat_digest;
+    walk(tree_digest, tu.get(), 0);
+    walk_flat(flat_digest, flat, 0, 0);
+    bool same = (tree_digest == flat_digest && flat.size() == tree_digest.m_nodes &&
+                 flat[0].m_next == flat.size());
+
+    SpanCheck spans;
+    walk(spans, tu.get(), 0);
+
+    std::cout << mode_name(mode) << ": " << flat.size() << " nodes, " <<
+        "arena " << parser.arena().bytes() << " bytes, " <<
+        "flat " << flat.bytes() << " bytes: " <<
+        (same ? "same" : "DIFFERENT") << ", " <<
+        spans.m_errors << " bad spans\n";
+    if (!same || spans.m_errors || !repeat)
+        return same && !spans.m_errors;
+
+    double tree_time = 1e9, flat_time = 1e9;
+    Counter tree_count, flat_count;
+    for (size_t k = 0; k < repeat; ++k)
+    {
+        tree_count = Counter();
+        start = std::chrono::steady_clock::now();
+        walk(tree_count, tu.get(), 0);
+        tree_time = std::min(tree_time, seconds_since(start));
+
+        flat_count = Counter();
+        start = std::chrono::steady_clock::now();
+        count_flat(flat_count, flat);
+        flat_time = std::min(flat_time, seconds_since(start));
+    }
+    std::cout << "  convert    " << convert_time * 1000 << " ms\n" <<
+        "  tree walk  " << tree_time * 1000 << " ms\n" <<
+        "  flat loop  " << flat_time * 1000 << " ms  (best of " << repeat << ")\n";
+    if (tree_count.m_idents != flat_count.m_idents ||
+        tree_count.m_str_bytes != flat_count.m_str_bytes)
+    {
+        std::cout << "  (the passes disagree)\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool check = false;
+    const char *fname = NULL;
+    size_t copies = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--check")
+            check = true;
+        else if (!fname)
+            fname = argv[i];
+        else
+            copies = strtoul(argv[i], NULL, 0);
+    }
+    if (!fname || !copies)
+    {
+        std::cerr << "usage: flat_bench [--check] input.i [COPIES]\n";
+        return 2;
+    }
+
+    std::ifstream file(fname, std::ios::binary);
+    string_type one((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+    if (!file)
+    {
+        std::cerr << "cannot open '" << fname << "'\n";
+        return 2;
+    }
+    string_type str;
+    for (size_t k = 0; k < copies; ++k)
+    {
+        str += one;
+    }
+
+    if (!check)
+        return check_and_time(str, MODE_PLAIN, 20) ? 0 : 1;
+
+    bool ok = true;
+    ok = check_and_time(str, MODE_PLAIN, 0) && ok;
+    ok = check_and_time(str, MODE_COMPACT, 0) && ok;
+    ok = check_and_time(str, MODE_LAZY, 0) && ok;
+    return ok ? 0 : 1;
+}
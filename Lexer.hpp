@@ -5,8 +5,10 @@
 
 #include "TextScanner.hpp"
 #include <set>     // for std::set
-#include <map>     // for std::multimap
+#include <map>     // for std::map
 #include <stack>   // for std::stack
+#include <deque>   // for std::deque
+#include <unordered_map>   // for std::unordered_map
 #ifndef NDEBUG
     #include <iostream>
 #endif
@@ -30,14 +32,133 @@ namespace CodeReverse
         TK_FLOATING_LITERAL,
     };
 
+    enum TokenID
+    {
+        TID_NONE = 0,
+        // keywords (in the order of get_keywords())
+        KW__ALIGNAS,
+        KW__ALIGNOF,
+        KW__ATOMIC,
+        KW__BOOL,
+        KW__COMPLEX,
+        KW__GENERIC,
+        KW__IMAGINARY,
+        KW__NORETURN,
+        KW__STATIC_ASSERT,
+        KW__THREAD_LOCAL,
+        KW___ASM,
+        KW___ASM__,
+        KW___ATTRIBUTE__,
+        KW___CDECL,
+        KW___DECLSPEC,
+        KW___FASTCALL,
+        KW___FLOAT128,
+        KW___FLOAT80,
+        KW___FORCEINLINE,
+        KW___INLINE,
+        KW___INLINE__,
+        KW___INT128,
+        KW___INT64,
+        KW___PRAGMA,
+        KW___PTR64,
+        KW___RESTRICT__,
+        KW___STDCALL,
+        KW___VOLATILE__,
+        KW_AUTO,
+        KW_BREAK,
+        KW_CASE,
+        KW_CHAR,
+        KW_CONST,
+        KW_CONTINUE,
+        KW_DEFAULT,
+        KW_DO,
+        KW_DOUBLE,
+        KW_ELSE,
+        KW_ENUM,
+        KW_EXTERN,
+        KW_FLOAT,
+        KW_FOR,
+        KW_GOTO,
+        KW_IF,
+        KW_INLINE,
+        KW_INT,
+        KW_LONG,
+        KW_REGISTER,
+        KW_RESTRICT,
+        KW_RETURN,
+        KW_SHORT,
+        KW_SIGNED,
+        KW_SIZEOF,
+        KW_STATIC,
+        KW_STRUCT,
+        KW_SWITCH,
+        KW_TYPEDEF,
+        KW_UNION,
+        KW_UNSIGNED,
+        KW_VOID,
+        KW_VOLATILE,
+        KW_WHILE,
+        // symbols (in the order of get_symbols())
+        SYM_NOT,         // !
+        SYM_NE,          // !=
+        SYM_SHARP,       // #
+        SYM_SHARP_SHARP, // ##
+        SYM_PERCENT,     // %
+        SYM_MOD_ASSIGN,  // %=
+        SYM_AMP,         // &
+        SYM_AND_AND,     // &&
+        SYM_AND_ASSIGN,  // &=
+        SYM_L_PAREN,     // (
+        SYM_R_PAREN,     // )
+        SYM_STAR,        // *
+        SYM_MUL_ASSIGN,  // *=
+        SYM_PLUS,        // +
+        SYM_INC,         // ++
+        SYM_ADD_ASSIGN,  // +=
+        SYM_COMMA,       // ,
+        SYM_MINUS,       // -
+        SYM_DEC,         // --
+        SYM_SUB_ASSIGN,  // -=
+        SYM_ARROW,       // ->
+        SYM_DOT,         // .
+        SYM_ELLIPSIS,    // ...
+        SYM_SLASH,       // /
+        SYM_DIV_ASSIGN,  // /=
+        SYM_COLON,       // :
+        SYM_SEMICOLON,   // ;
+        SYM_LT,          // <
+        SYM_SHL,         // <<
+        SYM_SHL_ASSIGN,  // <<=
+        SYM_LE,          // <=
+        SYM_ASSIGN,      // =
+        SYM_EQ,          // ==
+        SYM_GT,          // >
+        SYM_GE,          // >=
+        SYM_SHR,         // >>
+        SYM_SHR_ASSIGN,  // >>=
+        SYM_QUESTION,    // ?
+        SYM_L_BRACKET,   // [
+        SYM_R_BRACKET,   // ]
+        SYM_CARET,       // ^
+        SYM_XOR_ASSIGN,  // ^=
+        SYM_L_BRACE,     // {
+        SYM_BAR,         // |
+        SYM_OR_ASSIGN,   // |=
+        SYM_OR_OR,       // ||
+        SYM_R_BRACE,     // }
+        SYM_TILDE,       // ~
+    };
+
     struct Token
     {
         std::string     m_str;
         Position        m_pos;
         TokenType       m_type;
+        TokenID         m_id;   // keyword/symbol ID or TID_NONE
         std::string     m_fix;  // prefix or suffix
 
-        Token(const Position& pos, TokenType type) : m_pos(pos), m_type(type)
+        Token(const Position& pos, TokenType type)
+            : m_pos(pos), m_type(type), m_id(TID_NONE)
         {
         }
     };
@@ -51,6 +172,80 @@ namespace CodeReverse
         return os;
     }
 
+    /////////////////////////////////////////////////////////////////////////
+    // TokenStream
+    //
+    // The tokens of a lexer as parallel arrays. A token is its type, its ID,
+    // the offset and length of its text in the source buffer, its prefix or
+    // suffix and its position. The text of an identifier or a literal is
+    // interned into an atom on first use only, so that str() can return a
+    // reference; keywords and symbols share static strings. A Token is built
+    // only on demand by get().
+    //
+    // After index_brackets(), each '(', '[' and '{' knows its matching
+    // closer and vice versa. Any change of the tokens drops the index.
+    //
+    // Reading is not thread-safe until intern_all() has made the atoms.
+
+    class TokenStream
+    {
+    public:
+        typedef unsigned int atom_type;     // 0 for none
+
+        TokenStream();
+        void source(const char_type *text);
+
+        bool empty() const;
+        size_t size() const;
+        void clear();
+        void resize(size_t count);
+        void move(size_t to, size_t from);
+
+        void add(TokenType type, TokenID id, size_t offset, size_t length,
+                 const Position& pos);
+        void add_fix(const char_type *str, size_t len);
+        void push_back(const Token& token);
+        void set(size_t i, const Token& token);
+
+        TokenType type(size_t i) const;
+        TokenID id(size_t i) const;
+        size_t offset(size_t i) const;
+        size_t length(size_t i) const;
+        atom_type atom(size_t i) const;
+        const string_type& str(size_t i) const;
+        const string_type& fix(size_t i) const;
+        bool match(size_t i, const char_type *psz) const;
+        Position pos(size_t i) const;
+
+        Token get(size_t i) const;
+        void get(TokensType& tokens, size_t first, size_t last) const;
+
+        atom_type intern(const char_type *str, size_t len) const;
+        const string_type& atom_str(atom_type atom) const;
+        void intern_all();
+
+        void index_brackets();
+        bool brackets_indexed() const;
+        size_t matching(size_t i) const;
+        size_t close(size_t i, TokenID open, TokenID close) const;
+
+    protected:
+        const char_type *                   m_text;     // source buffer
+        std::vector<unsigned char>          m_types;
+        std::vector<unsigned short>         m_ids;
+        std::vector<unsigned int>           m_offsets;
+        std::vector<unsigned int>           m_lengths;
+        mutable std::vector<atom_type>      m_atoms;
+        std::vector<atom_type>              m_fixes;
+        std::vector<Position>               m_positions;
+        std::vector<unsigned int>           m_matches;  // matching brackets
+
+        // atom - 1 to text (a deque never moves its strings)
+        mutable std::deque<string_type>     m_strings;
+        typedef std::unordered_map<string_type, atom_type> atom_map_type;
+        mutable atom_map_type               m_atom_map;
+    };
+
     /////////////////////////////////////////////////////////////////////////
     // Lexer
 
@@ -59,40 +254,45 @@ namespace CodeReverse
     public:
         Lexer(TextScanner& scanner, AuxInfo& aux);
         Lexer(TextScanner& scanner, const TokensType& tokens, AuxInfo& aux);
+        ~Lexer();
 
         bool do_lex();
         void fixup();
 
         bool empty() const;
         size_t size() const;
-              Token& operator[](size_t i);
-        const Token& operator[](size_t i) const;
+        Token operator[](size_t i) const;
+        void set(size_t i, const Token& t);
         void push_back(const Token& t);
         void clear();
+        const TokenStream& tokens() const;
 
-              Token& token();
-        const Token& token() const;
+        Token token() const;
         void next();
         void prev();
         bool eof() const;
 
         TokenType type() const;
-        string_type str() const;
-        string_type fix() const;
+        TokenID id() const;
+        const string_type& str() const;
+        const string_type& fix() const;
 
         size_t index() const;
         void index(size_t pos);
         Position pos() const;
         void pos(const Position& pos_);
+        Position begin_pos(size_t first) const;
+        Position end_pos(size_t last) const;
 
         bool scan_number();
         bool scan_string_or_character();
         bool scan_identifier();
         bool scan_symbol();
-        bool do_floating_exponent(Token& token);
-        bool do_floating_suffix(Token& token);
-        bool do_integer_suffix(Token& token);
+        bool do_floating_exponent();
+        bool do_floating_suffix();
+        bool do_integer_suffix();
         bool do_directive(const string_type& str);
+        bool do_line_marker();
         bool do_line(const TokensType& tokens);
         bool do_pragma(const TokensType& tokens);
 
@@ -106,13 +306,12 @@ namespace CodeReverse
         int m_pack;
         size_t m_pragma_begin;
         size_t m_pragma_paren;
-        TokensType m_tokens;
-        typedef std::multimap<char_type, string_type> symbol_map_type;
-        symbol_map_type m_symbol_map;
-        typedef std::set<string_type> keyword_set_type;
-        keyword_set_type m_keywords;
+        TokenStream m_tokens;
+        size_t m_begin;             // the token being scanned
+        Position m_begin_pos;
         typedef std::stack<int> pack_stack_type;
         pack_stack_type m_pack_stack;
+        string_type m_line_file;    // buffer for do_line_marker
 
         friend class CParser;
 
@@ -127,8 +326,17 @@ namespace CodeReverse
         bool match_get(const char_type *psz, string_type& str);
         void push_pack(int pack);
         void pop_pack();
+        void begin_token();
+        void add_token(TokenType type, TokenID id = TID_NONE);
+        void add_token(TokenType type, size_t offset, size_t length);
+        void add_fix(size_t offset, size_t end);
+        void hold_buffer();
 
         void fixup_gnu_extensions();
+
+    private:
+        Lexer(const Lexer&);
+        Lexer& operator=(const Lexer&);
     };
 
     template <class CharT, class Traits>
@@ -161,6 +369,7 @@ namespace CodeReverse
                          const typename T_STR::value_type *to);
 
     /////////////////////////////////////////////////////////////////////////
+    // keyword and symbol tables (sorted by strcmp; shared by all lexers)
 
     inline const char **get_keywords(size_t& count)
     {
@@ -216,7 +425,7 @@ namespace CodeReverse
             "register",
             "restrict",
             "return",
-            "short ",
+            "short",
             "signed",
             "sizeof",
             "static",
@@ -292,38 +501,802 @@ namespace CodeReverse
         return s_symbols;
     }
 
+    // keyword_id --- classifies an identifier by its length and one character
+    inline TokenID keyword_id(const char_type *str, size_t len)
+    {
+        switch (len)
+        {
+        case 2:
+            switch (str[0])
+            {
+            case 'd':
+                if (memcmp(str, "do", 2) == 0)
+                    return KW_DO;
+                break;
+            case 'i':
+                if (memcmp(str, "if", 2) == 0)
+                    return KW_IF;
+                break;
+            }
+            break;
+        case 3:
+            switch (str[0])
+            {
+            case 'f':
+                if (memcmp(str, "for", 3) == 0)
+                    return KW_FOR;
+                break;
+            case 'i':
+                if (memcmp(str, "int", 3) == 0)
+                    return KW_INT;
+                break;
+            }
+            break;
+        case 4:
+            switch (str[0])
+            {
+            case 'a':
+                if (memcmp(str, "auto", 4) == 0)
+                    return KW_AUTO;
+                break;
+            case 'c':
+                if (memcmp(str, "case", 4) == 0)
+                    return KW_CASE;
+                if (memcmp(str, "char", 4) == 0)
+                    return KW_CHAR;
+                break;
+            case 'e':
+                if (memcmp(str, "else", 4) == 0)
+                    return KW_ELSE;
+                if (memcmp(str, "enum", 4) == 0)
+                    return KW_ENUM;
+                break;
+            case 'g':
+                if (memcmp(str, "goto", 4) == 0)
+                    return KW_GOTO;
+                break;
+            case 'l':
+                if (memcmp(str, "long", 4) == 0)
+                    return KW_LONG;
+                break;
+            case 'v':
+                if (memcmp(str, "void", 4) == 0)
+                    return KW_VOID;
+                break;
+            }
+            break;
+        case 5:
+            switch (str[0])
+            {
+            case '_':
+                if (memcmp(str, "_Bool", 5) == 0)
+                    return KW__BOOL;
+                if (memcmp(str, "__asm", 5) == 0)
+                    return KW___ASM;
+                break;
+            case 'b':
+                if (memcmp(str, "break", 5) == 0)
+                    return KW_BREAK;
+                break;
+            case 'c':
+                if (memcmp(str, "const", 5) == 0)
+                    return KW_CONST;
+                break;
+            case 'f':
+                if (memcmp(str, "float", 5) == 0)
+                    return KW_FLOAT;
+                break;
+            case 's':
+                if (memcmp(str, "short", 5) == 0)
+                    return KW_SHORT;
+                break;
+            case 'u':
+                if (memcmp(str, "union", 5) == 0)
+                    return KW_UNION;
+                break;
+            case 'w':
+                if (memcmp(str, "while", 5) == 0)
+                    return KW_WHILE;
+                break;
+            }
+            break;
+        case 6:
+            switch (str[2])
+            {
+            case 'a':
+                if (memcmp(str, "static", 6) == 0)
+                    return KW_STATIC;
+                break;
+            case 'g':
+                if (memcmp(str, "signed", 6) == 0)
+                    return KW_SIGNED;
+                break;
+            case 'i':
+                if (memcmp(str, "switch", 6) == 0)
+                    return KW_SWITCH;
+                break;
+            case 'l':
+                if (memcmp(str, "inline", 6) == 0)
+                    return KW_INLINE;
+                break;
+            case 'r':
+                if (memcmp(str, "struct", 6) == 0)
+                    return KW_STRUCT;
+                break;
+            case 't':
+                if (memcmp(str, "extern", 6) == 0)
+                    return KW_EXTERN;
+                if (memcmp(str, "return", 6) == 0)
+                    return KW_RETURN;
+                break;
+            case 'u':
+                if (memcmp(str, "double", 6) == 0)
+                    return KW_DOUBLE;
+                break;
+            case 'z':
+                if (memcmp(str, "sizeof", 6) == 0)
+                    return KW_SIZEOF;
+                break;
+            }
+            break;
+        case 7:
+            switch (str[3])
+            {
+            case 'a':
+                if (memcmp(str, "default", 7) == 0)
+                    return KW_DEFAULT;
+                break;
+            case 'd':
+                if (memcmp(str, "__cdecl", 7) == 0)
+                    return KW___CDECL;
+                break;
+            case 'e':
+                if (memcmp(str, "typedef", 7) == 0)
+                    return KW_TYPEDEF;
+                break;
+            case 'n':
+                if (memcmp(str, "__int64", 7) == 0)
+                    return KW___INT64;
+                break;
+            case 'o':
+                if (memcmp(str, "_Atomic", 7) == 0)
+                    return KW__ATOMIC;
+                break;
+            case 's':
+                if (memcmp(str, "__asm__", 7) == 0)
+                    return KW___ASM__;
+                break;
+            case 't':
+                if (memcmp(str, "__ptr64", 7) == 0)
+                    return KW___PTR64;
+                break;
+            }
+            break;
+        case 8:
+            switch (str[6])
+            {
+            case '2':
+                if (memcmp(str, "__int128", 8) == 0)
+                    return KW___INT128;
+                break;
+            case 'a':
+                if (memcmp(str, "_Alignas", 8) == 0)
+                    return KW__ALIGNAS;
+                break;
+            case 'c':
+                if (memcmp(str, "restrict", 8) == 0)
+                    return KW_RESTRICT;
+                break;
+            case 'e':
+                if (memcmp(str, "_Complex", 8) == 0)
+                    return KW__COMPLEX;
+                if (memcmp(str, "register", 8) == 0)
+                    return KW_REGISTER;
+                if (memcmp(str, "unsigned", 8) == 0)
+                    return KW_UNSIGNED;
+                break;
+            case 'i':
+                if (memcmp(str, "_Generic", 8) == 0)
+                    return KW__GENERIC;
+                break;
+            case 'l':
+                if (memcmp(str, "volatile", 8) == 0)
+                    return KW_VOLATILE;
+                break;
+            case 'm':
+                if (memcmp(str, "__pragma", 8) == 0)
+                    return KW___PRAGMA;
+                break;
+            case 'n':
+                if (memcmp(str, "__inline", 8) == 0)
+                    return KW___INLINE;
+                break;
+            case 'o':
+                if (memcmp(str, "_Alignof", 8) == 0)
+                    return KW__ALIGNOF;
+                break;
+            case 'u':
+                if (memcmp(str, "continue", 8) == 0)
+                    return KW_CONTINUE;
+                break;
+            }
+            break;
+        case 9:
+            switch (str[2])
+            {
+            case 'f':
+                if (memcmp(str, "__float80", 9) == 0)
+                    return KW___FLOAT80;
+                break;
+            case 'o':
+                if (memcmp(str, "_Noreturn", 9) == 0)
+                    return KW__NORETURN;
+                break;
+            case 's':
+                if (memcmp(str, "__stdcall", 9) == 0)
+                    return KW___STDCALL;
+                break;
+            }
+            break;
+        case 10:
+            switch (str[4])
+            {
+            case 'c':
+                if (memcmp(str, "__declspec", 10) == 0)
+                    return KW___DECLSPEC;
+                break;
+            case 'g':
+                if (memcmp(str, "_Imaginary", 10) == 0)
+                    return KW__IMAGINARY;
+                break;
+            case 'l':
+                if (memcmp(str, "__inline__", 10) == 0)
+                    return KW___INLINE__;
+                break;
+            case 'o':
+                if (memcmp(str, "__float128", 10) == 0)
+                    return KW___FLOAT128;
+                break;
+            case 's':
+                if (memcmp(str, "__fastcall", 10) == 0)
+                    return KW___FASTCALL;
+                break;
+            }
+            break;
+        case 12:
+            switch (str[2])
+            {
+            case 'r':
+                if (memcmp(str, "__restrict__", 12) == 0)
+                    return KW___RESTRICT__;
+                break;
+            case 'v':
+                if (memcmp(str, "__volatile__", 12) == 0)
+                    return KW___VOLATILE__;
+                break;
+            }
+            break;
+        case 13:
+            switch (str[2])
+            {
+            case 'a':
+                if (memcmp(str, "__attribute__", 13) == 0)
+                    return KW___ATTRIBUTE__;
+                break;
+            case 'f':
+                if (memcmp(str, "__forceinline", 13) == 0)
+                    return KW___FORCEINLINE;
+                break;
+            case 'h':
+                if (memcmp(str, "_Thread_local", 13) == 0)
+                    return KW__THREAD_LOCAL;
+                break;
+            }
+            break;
+        case 14:
+            if (memcmp(str, "_Static_assert", 14) == 0)
+                return KW__STATIC_ASSERT;
+            break;
+        }
+        return TID_NONE;
+    }
+
+    // symbol_id --- scans the longest symbol at str (maximal munch)
+    inline TokenID symbol_id(const char_type *str, size_t& len)
+    {
+        switch (str[0])
+        {
+        case '!':
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_NE;
+            }
+            len = 1;
+            return SYM_NOT;
+        case '#':
+            if (str[1] == '#')
+            {
+                len = 2;
+                return SYM_SHARP_SHARP;
+            }
+            len = 1;
+            return SYM_SHARP;
+        case '%':
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_MOD_ASSIGN;
+            }
+            len = 1;
+            return SYM_PERCENT;
+        case '&':
+            if (str[1] == '&')
+            {
+                len = 2;
+                return SYM_AND_AND;
+            }
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_AND_ASSIGN;
+            }
+            len = 1;
+            return SYM_AMP;
+        case '(':
+            len = 1;
+            return SYM_L_PAREN;
+        case ')':
+            len = 1;
+            return SYM_R_PAREN;
+        case '*':
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_MUL_ASSIGN;
+            }
+            len = 1;
+            return SYM_STAR;
+        case '+':
+            if (str[1] == '+')
+            {
+                len = 2;
+                return SYM_INC;
+            }
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_ADD_ASSIGN;
+            }
+            len = 1;
+            return SYM_PLUS;
+        case ',':
+            len = 1;
+            return SYM_COMMA;
+        case '-':
+            if (str[1] == '-')
+            {
+                len = 2;
+                return SYM_DEC;
+            }
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_SUB_ASSIGN;
+            }
+            if (str[1] == '>')
+            {
+                len = 2;
+                return SYM_ARROW;
+            }
+            len = 1;
+            return SYM_MINUS;
+        case '.':
+            if (str[1] == '.' && str[2] == '.')
+            {
+                len = 3;
+                return SYM_ELLIPSIS;
+            }
+            len = 1;
+            return SYM_DOT;
+        case '/':
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_DIV_ASSIGN;
+            }
+            len = 1;
+            return SYM_SLASH;
+        case ':':
+            len = 1;
+            return SYM_COLON;
+        case ';':
+            len = 1;
+            return SYM_SEMICOLON;
+        case '<':
+            if (str[1] == '<' && str[2] == '=')
+            {
+                len = 3;
+                return SYM_SHL_ASSIGN;
+            }
+            if (str[1] == '<')
+            {
+                len = 2;
+                return SYM_SHL;
+            }
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_LE;
+            }
+            len = 1;
+            return SYM_LT;
+        case '=':
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_EQ;
+            }
+            len = 1;
+            return SYM_ASSIGN;
+        case '>':
+            if (str[1] == '>' && str[2] == '=')
+            {
+                len = 3;
+                return SYM_SHR_ASSIGN;
+            }
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_GE;
+            }
+            if (str[1] == '>')
+            {
+                len = 2;
+                return SYM_SHR;
+            }
+            len = 1;
+            return SYM_GT;
+        case '?':
+            len = 1;
+            return SYM_QUESTION;
+        case '[':
+            len = 1;
+            return SYM_L_BRACKET;
+        case ']':
+            len = 1;
+            return SYM_R_BRACKET;
+        case '^':
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_XOR_ASSIGN;
+            }
+            len = 1;
+            return SYM_CARET;
+        case '{':
+            len = 1;
+            return SYM_L_BRACE;
+        case '|':
+            if (str[1] == '=')
+            {
+                len = 2;
+                return SYM_OR_ASSIGN;
+            }
+            if (str[1] == '|')
+            {
+                len = 2;
+                return SYM_OR_OR;
+            }
+            len = 1;
+            return SYM_BAR;
+        case '}':
+            len = 1;
+            return SYM_R_BRACE;
+        case '~':
+            len = 1;
+            return SYM_TILDE;
+        }
+        len = 0;
+        return TID_NONE;
+    }
+
     /////////////////////////////////////////////////////////////////////////
-    // Lexer inlines
+    // the text of a keyword or a symbol by TokenID
 
-    inline Lexer::Lexer(TextScanner& text, AuxInfo& aux)
-        : m_text(text), m_aux(aux), m_index(0), m_pack(1),
-          m_pragma_begin(-1), m_pragma_paren(0)
+    inline std::vector<string_type> make_token_id_strs()
     {
+        std::vector<string_type> strs(1);
         size_t count;
+        const char **keywords = get_keywords(count);
+        strs.insert(strs.end(), keywords, keywords + count);
         const char **symbols = get_symbols(count);
-        for (size_t i = 0; i < count; ++i)
+        strs.insert(strs.end(), symbols, symbols + count);
+        return strs;
+    }
+
+    inline const string_type& token_id_str(TokenID id)
+    {
+        static const std::vector<string_type> s_strs = make_token_id_strs();
+        assert(size_t(id) < s_strs.size());
+        return s_strs[id];
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // TokenStream inlines
+
+    inline TokenStream::TokenStream() : m_text("")
+    {
+    }
+    inline void TokenStream::source(const char_type *text)
+    {
+        m_text = text;
+    }
+    inline bool TokenStream::empty() const
+    {
+        return m_types.empty();
+    }
+    inline size_t TokenStream::size() const
+    {
+        return m_types.size();
+    }
+    inline void TokenStream::clear()
+    {
+        resize(0);
+    }
+    inline void TokenStream::resize(size_t count)
+    {
+        assert(count <= size());
+        m_types.resize(count);
+        m_ids.resize(count);
+        m_offsets.resize(count);
+        m_lengths.resize(count);
+        m_atoms.resize(count);
+        m_fixes.resize(count);
+        m_positions.resize(count);
+        m_matches.clear();
+    }
+    inline void TokenStream::move(size_t to, size_t from)
+    {
+        m_types[to] = m_types[from];
+        m_ids[to] = m_ids[from];
+        m_offsets[to] = m_offsets[from];
+        m_lengths[to] = m_lengths[from];
+        m_atoms[to] = m_atoms[from];
+        m_fixes[to] = m_fixes[from];
+        m_positions[to] = m_positions[from];
+        m_matches.clear();
+    }
+    inline void TokenStream::add(TokenType type, TokenID id,
+                                 size_t offset, size_t length,
+                                 const Position& pos)
+    {
+        assert(offset + length <= 0xFFFFFFFF);
+        m_types.push_back((unsigned char)type);
+        m_ids.push_back((unsigned short)id);
+        m_offsets.push_back((unsigned int)offset);
+        m_lengths.push_back((unsigned int)length);
+        m_atoms.push_back(0);
+        m_fixes.push_back(0);
+        m_positions.push_back(pos);
+    }
+    // sets the prefix or suffix of the last token
+    inline void TokenStream::add_fix(const char_type *str, size_t len)
+    {
+        m_fixes.back() = intern(str, len);
+    }
+    inline void TokenStream::push_back(const Token& token)
+    {
+        add(token.m_type, token.m_id, 0, token.m_str.size(), token.m_pos);
+        m_atoms.back() = intern(token.m_str.c_str(), token.m_str.size());
+        if (token.m_fix.size())
+            add_fix(token.m_fix.c_str(), token.m_fix.size());
+    }
+    // replaces the token; its text is interned as by push_back()
+    inline void TokenStream::set(size_t i, const Token& token)
+    {
+        m_types[i] = (unsigned char)token.m_type;
+        m_ids[i] = (unsigned short)token.m_id;
+        m_offsets[i] = 0;
+        m_lengths[i] = (unsigned int)token.m_str.size();
+        m_atoms[i] = intern(token.m_str.c_str(), token.m_str.size());
+        m_fixes[i] = 0;
+        if (token.m_fix.size())
+            m_fixes[i] = intern(token.m_fix.c_str(), token.m_fix.size());
+        m_positions[i] = token.m_pos;
+        m_matches.clear();
+    }
+    inline TokenType TokenStream::type(size_t i) const
+    {
+        return TokenType(m_types[i]);
+    }
+    inline TokenID TokenStream::id(size_t i) const
+    {
+        return TokenID(m_ids[i]);
+    }
+    inline size_t TokenStream::offset(size_t i) const
+    {
+        return m_offsets[i];
+    }
+    inline size_t TokenStream::length(size_t i) const
+    {
+        return m_lengths[i];
+    }
+    inline TokenStream::atom_type TokenStream::atom(size_t i) const
+    {
+        if (m_atoms[i] == 0 && m_ids[i] == TID_NONE)
+            m_atoms[i] = intern(m_text + m_offsets[i], m_lengths[i]);
+        return m_atoms[i];
+    }
+    inline const string_type& TokenStream::str(size_t i) const
+    {
+        if (m_atoms[i] == 0 && m_ids[i] != TID_NONE)
+            return token_id_str(id(i));
+        return atom_str(atom(i));
+    }
+    inline const string_type& TokenStream::fix(size_t i) const
+    {
+        return atom_str(m_fixes[i]);
+    }
+    // compares the text without interning it
+    inline bool TokenStream::match(size_t i, const char_type *psz) const
+    {
+        if (m_atoms[i] || m_ids[i] != TID_NONE)
+            return str(i) == psz;
+        size_t len = m_lengths[i];
+        return strncmp(m_text + m_offsets[i], psz, len) == 0 && psz[len] == 0;
+    }
+    inline Position TokenStream::pos(size_t i) const
+    {
+        return m_positions[i];
+    }
+    // pairs the brackets in one pass with a stack for each kind, so that
+    // a kind nests regardless of the others (as counting them would do)
+    inline void TokenStream::index_brackets()
+    {
+        m_matches.assign(size(), unsigned(-1));
+        std::vector<unsigned int> stacks[3];
+        for (size_t i = 0; i < size(); ++i)
         {
-            m_symbol_map.insert(std::make_pair(*symbols[i], symbols[i]));
+            int kind;
+            bool open;
+            switch (m_ids[i])
+            {
+            case SYM_L_PAREN:   kind = 0; open = true; break;
+            case SYM_R_PAREN:   kind = 0; open = false; break;
+            case SYM_L_BRACKET: kind = 1; open = true; break;
+            case SYM_R_BRACKET: kind = 1; open = false; break;
+            case SYM_L_BRACE:   kind = 2; open = true; break;
+            case SYM_R_BRACE:   kind = 2; open = false; break;
+            default:
+                continue;
+            }
+            std::vector<unsigned int>& stack = stacks[kind];
+            if (open)
+            {
+                stack.push_back(unsigned(i));
+            }
+            else if (!stack.empty())
+            {
+                m_matches[i] = stack.back();
+                m_matches[stack.back()] = unsigned(i);
+                stack.pop_back();
+            }
         }
-
-        const char **keywords = get_keywords(count);
-        for (size_t i = 0; i < count; ++i)
+    }
+    inline bool TokenStream::brackets_indexed() const
+    {
+        return m_matches.size() == size();
+    }
+    // the index of the matching bracket, or size() if none
+    inline size_t TokenStream::matching(size_t i) const
+    {
+        assert(brackets_indexed());
+        return std::min(size_t(m_matches[i]), size());
+    }
+    // the index of the closer matching the first opener from i, or size()
+    inline size_t TokenStream::close(size_t i, TokenID open, TokenID close) const
+    {
+        bool indexed = brackets_indexed();
+        int nest = 0;
+        for (; i < size(); ++i)
+        {
+            TokenID id = TokenID(m_ids[i]);
+            if (id == open)
+            {
+                if (nest == 0 && indexed)
+                    return matching(i);
+                ++nest;
+            }
+            else if (id == close)
+            {
+                --nest;
+                if (nest == 0)
+                    return i;
+            }
+        }
+        return size();
+    }
+    inline Token TokenStream::get(size_t i) const
+    {
+        Token token(pos(i), type(i));
+        token.m_str = str(i);
+        token.m_id = id(i);
+        token.m_fix = fix(i);
+        return token;
+    }
+    inline void
+    TokenStream::get(TokensType& tokens, size_t first, size_t last) const
+    {
+        tokens.reserve(tokens.size() + (last - first));
+        for (size_t i = first; i < last; ++i)
         {
-            m_keywords.insert(keywords[i]);
+            tokens.push_back(get(i));
         }
     }
+    inline TokenStream::atom_type
+    TokenStream::intern(const char_type *str, size_t len) const
+    {
+        string_type text(str, len);
+        atom_map_type::iterator it = m_atom_map.find(text);
+        if (it != m_atom_map.end())
+            return it->second;
+
+        m_strings.push_back(text);
+        atom_type atom = atom_type(m_strings.size());
+        m_atom_map.insert(std::make_pair(text, atom));
+        return atom;
+    }
+    inline const string_type& TokenStream::atom_str(atom_type atom) const
+    {
+        static const string_type s_empty;
+        if (atom == 0)
+            return s_empty;
+        return m_strings[atom - 1];
+    }
+    // makes the atoms of all the tokens now, so that reading changes nothing
+    inline void TokenStream::intern_all()
+    {
+        for (size_t i = 0; i < size(); ++i)
+        {
+            atom(i);
+        }
+    }
+    /////////////////////////////////////////////////////////////////////////
+    // Lexer inlines
+
+    inline Lexer::Lexer(TextScanner& text, AuxInfo& aux)
+        : m_text(text), m_aux(aux), m_index(0), m_pack(1),
+          m_pragma_begin(-1), m_pragma_paren(0), m_begin(0)
+    {
+        m_tokens.source(m_text.text());
+        hold_buffer();
+    }
     inline Lexer::Lexer(TextScanner& scanner, const TokensType& tokens, AuxInfo& aux)
         : m_text(scanner), m_aux(aux), m_index(0), m_pack(1),
-          m_pragma_begin(-1), m_pragma_paren(0), m_tokens(tokens)
+          m_pragma_begin(-1), m_pragma_paren(0), m_begin(0)
+    {
+        m_tokens.source(m_text.text());
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            m_tokens.push_back(tokens[i]);
+        }
+        hold_buffer();
+    }
+    inline Lexer::~Lexer()
     {
+        if (m_text.buffer() != unsigned(-1))
+            FileTable::instance().unhold_buffer(m_text.buffer());
     }
-    inline Token& Lexer::token()
+    // the positions of the tokens refer to the buffer of the scanner
+    inline void Lexer::hold_buffer()
     {
-        return m_tokens[m_index];
+        if (m_text.buffer() != unsigned(-1))
+            FileTable::instance().hold_buffer(m_text.buffer());
     }
-    inline const Token& Lexer::token() const
+    inline Token Lexer::token() const
     {
-        return m_tokens[m_index];
+        return m_tokens.get(m_index);
     }
     inline void Lexer::next()
     {
@@ -341,15 +1314,19 @@ namespace CodeReverse
     }
     inline TokenType Lexer::type() const
     {
-        return token().m_type;
+        return m_tokens.type(m_index);
+    }
+    inline TokenID Lexer::id() const
+    {
+        return m_tokens.id(m_index);
     }
-    inline string_type Lexer::str() const
+    inline const string_type& Lexer::str() const
     {
-        return token().m_str;
+        return m_tokens.str(m_index);
     }
-    inline string_type Lexer::fix() const
+    inline const string_type& Lexer::fix() const
     {
-        return token().m_fix;
+        return m_tokens.fix(m_index);
     }
     inline size_t Lexer::index() const
     {
@@ -367,6 +1344,20 @@ namespace CodeReverse
     {
         m_text.pos(pos_);
     }
+    // the position of the token 'first' of a span [first, last)
+    inline Position Lexer::begin_pos(size_t first) const
+    {
+        assert(first < m_tokens.size());
+        return m_tokens.pos(first);
+    }
+    // the position next to the token 'last - 1' of a span [first, last)
+    inline Position Lexer::end_pos(size_t last) const
+    {
+        assert(0 < last && last <= m_tokens.size());
+        Position pos = m_tokens.pos(last - 1);
+        pos.m_offset += (unsigned int)m_tokens.length(last - 1);
+        return pos;
+    }
     inline bool Lexer::empty() const
     {
         return size() == 0;
@@ -375,18 +1366,24 @@ namespace CodeReverse
     {
         return m_tokens.size();
     }
-    inline Token& Lexer::operator[](size_t i)
+    inline Token Lexer::operator[](size_t i) const
     {
-        return m_tokens[i];
+        return m_tokens.get(i);
     }
-    inline const Token& Lexer::operator[](size_t i) const
+    // NOTE: The tokens are kept as arrays, so a token is changed by getting
+    //       a copy and setting it back.
+    inline void Lexer::set(size_t i, const Token& t)
     {
-        return m_tokens[i];
+        m_tokens.set(i, t);
     }
     inline void Lexer::push_back(const Token& t)
     {
         m_tokens.push_back(t);
     }
+    inline const TokenStream& Lexer::tokens() const
+    {
+        return m_tokens;
+    }
     inline void Lexer::clear()
     {
         m_tokens.clear();
@@ -441,60 +1438,76 @@ namespace CodeReverse
             m_pack_stack.pop();
         }
     }
+    inline void Lexer::begin_token()
+    {
+        m_begin = m_text.index();
+        m_begin_pos = m_text.pos();
+    }
+    // adds the token from begin_token() to here
+    inline void Lexer::add_token(TokenType type, TokenID id)
+    {
+        m_tokens.add(type, id, m_begin, m_text.index() - m_begin, m_begin_pos);
+    }
+    // adds the token from begin_token(), with the given text
+    inline void Lexer::add_token(TokenType type, size_t offset, size_t length)
+    {
+        m_tokens.add(type, TID_NONE, offset, length, m_begin_pos);
+    }
+    // sets the prefix or suffix of the last token
+    inline void Lexer::add_fix(size_t offset, size_t end)
+    {
+        if (offset < end)
+            m_tokens.add_fix(m_text.text() + offset, end - offset);
+    }
     inline bool Lexer::do_lex()
     {
         char_type ch;
 
+        // the offsets in the tokens and in Position are 32-bit
+        if (m_text.size() > 0xFFFFFFFF)
+        {
+            m_aux.add_error(pos(), "input too large (4 GiB or more)");
+            return false;
+        }
+
         m_pragma_paren = 0;
         m_pragma_begin = size_t(-1);
 
         for (;;)
         {
-            for (;;)
-            {
-                ch = peekch();
-                if (!is_space(ch))
-                    break;
-                nextch();
-            }
+            m_text.skip_spaces();
+            ch = peekch();
 
-            if (match_get("/*"))    // */
+            if (ch == '/' && match_get("/*"))    // */
             {
-                do
+                if (!m_text.skip_after('*', '/'))
                 {
-                    if (peekch() == 0)
-                    {
-                        m_aux.add_error(pos(), "comment not terminated");
-                        return false;
-                    }
-                    nextch();
-                } while (!match_get("*/"));
+                    m_aux.add_error(pos(), "comment not terminated");
+                    return false;
+                }
                 continue;
             }
 
-            if (match_get("//"))
+            if (ch == '/' && match_get("//"))
             {
-                nextch();
-                for (;;)
-                {
-                    nextch();
-                    ch = peekch(); 
-                    if (ch == 0 || ch == '\n')
-                        break;
-                }
+                m_text.skip_to('\n');
                 continue;
             }
 
             if (ch == '#')
             {
+                nextch();
+                if (do_line_marker())
+                    continue;
+
                 string_type str;
                 for (;;)
                 {
-                    nextch();
-                    ch = peekch(); 
+                    ch = peekch();
                     if (ch == 0 || ch == '\n')
                         break;
                     str += ch;
+                    nextch();
                 }
                 str_trim(str);
                 do_directive(str);
@@ -551,32 +1564,33 @@ namespace CodeReverse
             return false;
         }
 
-        Token token(pos(), TK_EOF);
-        push_back(token);
+        begin_token();
+        add_token(TK_EOF);
         return true;
     }
     inline bool Lexer::scan_number()
     {
         char_type ch;
-        Token token(pos(), TK_INTEGER_LITERAL);
+        begin_token();
 
-        if (match_get("0x", token.m_str) || match_get("0X", token.m_str))
+        if (match_get("0x") || match_get("0X"))
         {
             for (;;)
             {
                 ch = peekch();
                 if (!is_xdigit(ch))
                     break;
-                token.m_str += ch;
                 nextch();
             }
 
-            if (!do_integer_suffix(token))
+            size_t end = m_text.index();
+            if (!do_integer_suffix())
             {
                 return false;
             }
 
-            push_back(token);
+            add_token(TK_INTEGER_LITERAL, m_begin, end - m_begin);
+            add_fix(end, m_text.index());
             return true;
         }
 
@@ -585,15 +1599,12 @@ namespace CodeReverse
             ch = peekch();
             if (!is_digit(ch))
                 break;
-            token.m_str += ch;
             nextch();
         }
 
         ch = peekch();
         if (ch == '.')
         {
-            token.m_str += ch;
-            token.m_type = TK_FLOATING_LITERAL;
             nextch();
 
             for (;;)
@@ -601,57 +1612,61 @@ namespace CodeReverse
                 ch = peekch();
                 if (!is_digit(ch))
                     break;
-                token.m_str += ch;
                 nextch();
             }
 
-            if (!do_floating_exponent(token) ||
-                !do_floating_suffix(token))
-            {
+            if (!do_floating_exponent())
+                return false;
+
+            size_t end = m_text.index();
+            if (!do_floating_suffix())
                 return false;
-            }
 
-            push_back(token);
+            add_token(TK_FLOATING_LITERAL, m_begin, end - m_begin);
+            add_fix(end, m_text.index());
             return true;
         }
 
         if (ch == 'e' || ch == 'E')
         {
-            if (!do_floating_exponent(token) ||
-                !do_floating_suffix(token))
-            {
+            if (!do_floating_exponent())
+                return false;
+
+            size_t end = m_text.index();
+            if (!do_floating_suffix())
                 return false;
-            }
 
-            push_back(token);
+            add_token(TK_INTEGER_LITERAL, m_begin, end - m_begin);
+            add_fix(end, m_text.index());
             return true;
         }
 
-        if (!do_integer_suffix(token))
+        size_t end = m_text.index();
+        if (!do_integer_suffix())
             return false;
 
-        if (token.m_str[0] == '0' &&
-            (token.m_str.find('8') != string_type::npos ||
-             token.m_str.find('9') != string_type::npos))
+        const char_type *text = m_text.text();
+        if (text[m_begin] == '0' &&
+            (memchr(text + m_begin, '8', end - m_begin) ||
+             memchr(text + m_begin, '9', end - m_begin)))
         {
             return false;
         }
 
-        push_back(token);
+        add_token(TK_INTEGER_LITERAL, m_begin, end - m_begin);
+        add_fix(end, m_text.index());
         return true;
     }
-    inline bool Lexer::do_floating_exponent(Token& token)
+    inline bool Lexer::do_floating_exponent()
     {
         char_type ch = peekch();
         if (ch == 'e' || ch == 'E')
         {
-            token.m_str += ch;
             nextch();
 
             ch = peekch();
             if (ch == '+' || ch == '-')
             {
-                token.m_str += ch;
                 nextch();
             }
 
@@ -662,7 +1677,6 @@ namespace CodeReverse
                 if (!is_digit(ch))
                     break;
                 has_exp = true;
-                token.m_str += ch;
                 nextch();
             }
 
@@ -670,7 +1684,7 @@ namespace CodeReverse
         }
         return true;
     }
-    inline bool Lexer::do_floating_suffix(Token& token)
+    inline bool Lexer::do_floating_suffix()
     {
         for (;;)
         {
@@ -678,7 +1692,6 @@ namespace CodeReverse
             switch (ch)
             {
             case 'l': case 'f': case 'L': case 'F':
-                token.m_fix += ch;
                 break;
             default:
                 return true;
@@ -686,7 +1699,7 @@ namespace CodeReverse
             nextch();
         }
     }
-    inline bool Lexer::do_integer_suffix(Token& token)
+    inline bool Lexer::do_integer_suffix()
     {
         for (;;)
         {
@@ -694,7 +1707,6 @@ namespace CodeReverse
             switch (ch)
             {
             case 'u': case 'l': case 'U': case 'L':
-                token.m_fix += ch;
                 break;
             default:
                 return true;
@@ -779,13 +1791,128 @@ namespace CodeReverse
         pos(Position(file.c_str(), line - 1));
         return true;
     }
+    // Handles the directive after '#' directly on the text, without
+    // allocating. Returns false for '#pragma' (and for a broken line marker),
+    // which is left to do_directive. Other directives are ignored.
+    //
+    // line-marker = '#', ['line'], digit-sequence, [string-literal, {digit-sequence}];
+    inline bool Lexer::do_line_marker()
+    {
+        const char_type *begin = m_text.peek();
+        const char_type *p = begin;
+        while (*p == ' ' || *p == '\t')
+            ++p;
+
+        const char_type *word = p;
+        while (is_alnum(*p) || *p == '_')
+            ++p;
+        if (p - word == 6 && memcmp(word, "pragma", 6) == 0)
+            return false;
+        if (p - word == 4 && memcmp(word, "line", 4) == 0)
+        {
+            while (*p == ' ' || *p == '\t')
+                ++p;
+        }
+        else
+        {
+            p = word;
+        }
+
+        if (is_digit(*p))
+        {
+            // NOTE: C99 6.10.4 allows up to 2147483647. A larger line number
+            //       is reported and the marker is ignored.
+            const size_t max_line = 0x7FFFFFFF;
+            size_t line = 0;
+            bool out_of_range = false;
+            do
+            {
+                size_t digit = *p - '0';
+                if (line > (max_line - digit) / 10)
+                    out_of_range = true;
+                else
+                    line = line * 10 + digit;
+                ++p;
+            } while (is_digit(*p));
+
+            if (out_of_range)
+            {
+                m_aux.add_warning(pos(), "line number out of range");
+                while (*p != 0 && *p != '\n')
+                    ++p;
+                skip(p - begin);
+                return true;
+            }
+
+            while (*p == ' ' || *p == '\t')
+                ++p;
+
+            const char_type *file = NULL, *file_end = NULL;
+            bool escaped = false;
+            if (*p == '"')
+            {
+                file = ++p;
+                while (*p != '"')
+                {
+                    if (*p == 0 || *p == '\n')
+                        return false;
+                    if (*p == '\\')
+                    {
+                        escaped = true;
+                        ++p;
+                        if (*p == 0 || *p == '\n')
+                            return false;
+                    }
+                    ++p;
+                }
+                file_end = p;
+            }
+
+            if (file && escaped)
+            {
+                // MSVC escapes the backslashes in paths
+                m_line_file.clear();
+                for (const char_type *q = file; q < file_end; ++q)
+                {
+                    if (*q == '\\')
+                    {
+                        ++q;
+                        if (*q != '\\' && *q != '"')
+                        {
+                            m_line_file = str_unquote(string_type(file - 1, file_end + 1), '"');
+                            break;
+                        }
+                    }
+                    m_line_file += *q;
+                }
+            }
+
+            while (*p != 0 && *p != '\n')
+                ++p;
+            skip(p - begin);
+
+            if (file && escaped)
+                m_text.file(m_line_file.c_str(), m_line_file.size());
+            else if (file)
+                m_text.file(file, file_end - file);
+            m_text.line(line - 2);  // the newline makes it (line - 1)
+            return true;
+        }
+
+        // ignore other directives
+        while (*p != 0 && *p != '\n')
+            ++p;
+        skip(p - begin);
+        return true;
+    }
     inline bool Lexer::do_directive(const string_type& str)
     {
-        TextScanner text(str);
+        TextScanner text(str, true);
         Lexer lexer(text, m_aux);
         lexer.do_lex();
 
-        auto& tokens = lexer.m_tokens;
+        TokensType tokens;
+        lexer.m_tokens.get(tokens, 0, lexer.size());
         if (tokens[0].m_str == "pragma")
         {
             tokens.erase(tokens.begin());
@@ -800,25 +1927,25 @@ namespace CodeReverse
     }
     inline bool Lexer::scan_string_or_character()
     {
-        Token token(pos(), TK_STRING_LITERAL);
+        TokenType type;
+        begin_token();
 
         char_type ch = peekch();
         if (ch == 'L')
         {
-            token.m_fix += ch;
             nextch();
         }
 
+        size_t begin = m_text.index();
         char_type ch0 = ch = peekch();
 
         if (ch == '\'')
-            token.m_type = TK_CHARACTER_LITERAL;
+            type = TK_CHARACTER_LITERAL;
         else if (ch == '"')
-            token.m_type = TK_STRING_LITERAL;
+            type = TK_STRING_LITERAL;
         else
             return false;
 
-        token.m_str += ch;
         nextch();
 
         for (;;)
@@ -829,7 +1956,6 @@ namespace CodeReverse
             case 0:
                 return false;
             case '\\':
-                token.m_str += ch;
                 nextch();
 
                 ch = peekch();
@@ -837,159 +1963,119 @@ namespace CodeReverse
             default:
                 if (ch == ch0)
                 {
-                    token.m_str += ch;
                     nextch();
 
                     ch = peekch();
                     if (ch != ch0)
                     {
-                        push_back(token);
+                        add_token(type, begin, m_text.index() - begin);
+                        add_fix(m_begin, begin);
                         return true;
                     }
                 }
                 break;
             }
-            token.m_str += ch;
             nextch();
         }
     }
     inline bool Lexer::scan_identifier()
     {
-        Token token(pos(), TK_IDENTIFIER);
-
-        char_type ch = peekch();
-        if (!is_alpha(ch) && ch != '_')
+        const char_type *begin = m_text.peek();
+        const char_type *end = begin;
+        if (!is_alpha(*end) && *end != '_')
             return false;
 
-        token.m_str += ch;
-        nextch();
-
-        for (;;)
+        do
         {
-            ch = peekch();
-            if (!is_alnum(ch) && ch != '_')
-                break;
-            token.m_str += ch;
-            nextch();
-        }
+            ++end;
+        } while (is_alnum(*end) || *end == '_');
 
-        if (m_keywords.count(token.m_str) > 0)
-        {
-            token.m_type = TK_KEYWORD;
+        size_t len = end - begin;
+        begin_token();
+        skip(len);
 
-            if (token.m_str == "__pragma")
+        TokenID id = keyword_id(begin, len);
+        if (id != TID_NONE)
+        {
+            if (id == KW___PRAGMA)
             {
                 m_pragma_begin = m_tokens.size();
                 m_pragma_paren = 0;
             }
+            add_token(TK_KEYWORD, id);
+        }
+        else
+        {
+            add_token(TK_IDENTIFIER);
         }
-
-        push_back(token);
         return true;
     }
     inline bool Lexer::scan_symbol()
     {
-        Token token(pos(), TK_SYMBOL);
+        size_t len;
+        TokenID id = symbol_id(m_text.peek(), len);
+        if (id == TID_NONE)
+            return false;
 
-        char_type ch = peekch();
-        string_type str;
-        typedef symbol_map_type::iterator IT;
-        std::pair<IT, IT> p = m_symbol_map.equal_range(ch);
-        for (IT it = p.first; it != p.second; ++it)
+        begin_token();
+        skip(len);
+        add_token(TK_SYMBOL, id);
+
+        if (m_pragma_begin != size_t(-1))
         {
-            if (match_peek(it->second.c_str(), str))
+            if (id == SYM_L_PAREN)
             {
-                if (token.m_str.size() < str.size())
-                {
-                    token.m_str = str;
-                }
+                ++m_pragma_paren;
             }
-        }
-
-        if (token.m_str.size())
-        {
-            skip(token.m_str.size());
-            push_back(token);
-
-            if (m_pragma_begin != size_t(-1))
+            else if (id == SYM_R_PAREN)
             {
-                if (token.m_str == "(")
-                {
-                    ++m_pragma_paren;
-                }
-                else if (token.m_str == ")")
+                --m_pragma_paren;
+                if (m_pragma_paren == 0)
                 {
-                    --m_pragma_paren;
-                    if (m_pragma_paren == 0)
-                    {
-                        TokensType tokens(m_tokens.begin() + m_pragma_begin, m_tokens.end());
-                        m_tokens.erase(m_tokens.begin() + m_pragma_begin, m_tokens.end());
-                        tokens.erase(tokens.begin() + tokens.size() - 1);
-                        tokens.erase(tokens.begin());
-                        tokens.erase(tokens.begin());
-                        do_pragma(tokens);
-                        m_pragma_begin = -1;
-                    }
+                    TokensType tokens;
+                    m_tokens.get(tokens, m_pragma_begin, m_tokens.size());
+                    m_tokens.resize(m_pragma_begin);
+                    tokens.erase(tokens.begin() + tokens.size() - 1);
+                    tokens.erase(tokens.begin());
+                    tokens.erase(tokens.begin());
+                    do_pragma(tokens);
+                    m_pragma_begin = -1;
                 }
             }
-            return true;
         }
-
-        return false;
+        return true;
     }
+
     inline void Lexer::fixup()
     {
         fixup_gnu_extensions();
+        m_tokens.index_brackets();
     }
     inline void Lexer::fixup_gnu_extensions()
     {
+        // compact in one pass (erasing one by one was quadratic)
+        size_t k = 0;
         for (size_t i = 0; i < size(); ++i)
         {
-            if (m_tokens[i].m_str == "__extension__")
+            if (m_tokens.type(i) == TK_IDENTIFIER &&
+                m_tokens.match(i, "__extension__"))
             {
-                m_tokens.erase(m_tokens.begin() + i);
-                --i;
+                continue;
             }
+            if (k != i)
+                m_tokens.move(k, i);
+            ++k;
         }
+        m_tokens.resize(k);
     }
 
     inline size_t Lexer::paren_close(size_t i) const
     {
-        int nest = 0;
-        for (; i < m_tokens.size(); ++i)
-        {
-            const string_type& str = m_tokens[i].m_str;
-            if (str == "(")
-            {
-				++nest;
-            }
-            else if (str == ")")
-            {
-                --nest;
-                if (nest == 0)
-                    return i;
-            }
-        }
-        return m_tokens.size();
+        return m_tokens.close(i, SYM_L_PAREN, SYM_R_PAREN);
     }
     inline size_t Lexer::brace_close(size_t i) const
     {
-        int nest = 0;
-        for (; i < m_tokens.size(); ++i)
-        {
-            const string_type& str = m_tokens[i].m_str;
-            if (str == "{")
-            {
-				++nest;
-            }
-            else if (str == "}")
-            {
-                --nest;
-                if (nest == 0)
-                    return i;
-            }
-        }
-        return m_tokens.size();
+        return m_tokens.close(i, SYM_L_BRACE, SYM_R_BRACE);
     }
 
     /////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,198 @@
+// LexerBench.cpp --- checks and times the keyword and symbol tables
+// Copyright (C) 2017 Katayama Hirofumi MZ. License: MIT License
+#include "Lexer.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+using namespace CodeReverse;
+
+/////////////////////////////////////////////////////////////////////////
+// the symbol scanner before symbol_id(): the candidates of the first
+// character in a multimap, each tried with match_peek
+
+typedef std::multimap<char_type, string_type> symbol_map_type;
+
+symbol_map_type make_symbol_map()
+{
+    symbol_map_type map;
+    size_t count;
+    const char **symbols = get_symbols(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        map.insert(std::make_pair(*symbols[i], string_type(symbols[i])));
+    }
+    return map;
+}
+
+// the length of the longest symbol at the scanner, or zero
+size_t old_scan_symbol(const symbol_map_type& map, const TextScanner& text)
+{
+    size_t len = 0;
+    string_type str;
+    typedef symbol_map_type::const_iterator IT;
+    std::pair<IT, IT> p = map.equal_range(text.peekch());
+    for (IT it = p.first; it != p.second; ++it)
+    {
+        if (text.match_peek(it->second.c_str(), str))
+        {
+            if (len < str.size())
+                len = str.size();
+        }
+    }
+    return len;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// checks
+
+int check_keywords()
+{
+    int errors = 0;
+    size_t count;
+    const char **keywords = get_keywords(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        string_type str = keywords[i];
+        TokenID id = keyword_id(str.c_str(), str.size());
+        if (id != TokenID(KW__ALIGNAS + i) || token_id_str(id) != str)
+        {
+            std::cerr << "keyword_id: wrong id for '" << str << "'\n";
+            ++errors;
+        }
+        // a longer or a shorter identifier is not the keyword
+        string_type longer = str + "_";
+        if (keyword_id(longer.c_str(), longer.size()) != TID_NONE)
+        {
+            std::cerr << "keyword_id: '" << longer << "' is not a keyword\n";
+            ++errors;
+        }
+        string_type shorter = str.substr(0, str.size() - 1);
+        TokenID other = keyword_id(shorter.c_str(), shorter.size());
+        if (other != TID_NONE && token_id_str(other) != shorter)
+        {
+            std::cerr << "keyword_id: wrong id for '" << shorter << "'\n";
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+// every symbol, alone and followed by every symbol, against the old scanner
+int check_symbols()
+{
+    int errors = 0;
+    symbol_map_type map = make_symbol_map();
+    size_t count;
+    const char **symbols = get_symbols(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t len;
+        TokenID id = symbol_id(symbols[i], len);
+        if (id != TokenID(SYM_NOT + i) || len != strlen(symbols[i]) ||
+            token_id_str(id) != symbols[i])
+        {
+            std::cerr << "symbol_id: wrong id for '" << symbols[i] << "'\n";
+            ++errors;
+        }
+        for (size_t j = 0; j < count; ++j)
+        {
+            string_type str = string_type(symbols[i]) + symbols[j];
+            TextScanner text(str, true);
+            size_t old_len = old_scan_symbol(map, text);
+            id = symbol_id(str.c_str(), len);
+            if (len != old_len ||
+                token_id_str(id) != str.substr(0, old_len))
+            {
+                std::cerr << "symbol_id: '" << str << "' scans as '" <<
+                    str.substr(0, len) << "', not '" <<
+                    str.substr(0, old_len) << "'\n";
+                ++errors;
+            }
+        }
+    }
+    return errors;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// timing
+
+// every symbol 'repeat' times, each followed by a space
+string_type make_symbol_text(size_t repeat, size_t& symbol_count)
+{
+    size_t count;
+    const char **symbols = get_symbols(count);
+    string_type str;
+    for (size_t k = 0; k < repeat; ++k)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            str += symbols[i];
+            str += ' ';
+        }
+    }
+    symbol_count = repeat * count;
+    return str;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+void bench_symbols(size_t repeat)
+{
+    size_t symbol_count;
+    string_type str = make_symbol_text(repeat, symbol_count);
+    symbol_map_type map = make_symbol_map();
+
+    size_t total_old = 0;
+    TextScanner text(str);
+    auto start = std::chrono::steady_clock::now();
+    while (text.peekch())
+    {
+        size_t len = old_scan_symbol(map, text);
+        total_old += len;
+        text.skip(len + 1);
+    }
+    double old_time = seconds_since(start);
+
+    size_t total_new = 0;
+    const char_type *p = str.c_str();
+    start = std::chrono::steady_clock::now();
+    while (*p)
+    {
+        size_t len;
+        symbol_id(p, len);
+        total_new += len;
+        p += len + 1;
+    }
+    double new_time = seconds_since(start);
+
+    std::cout << symbol_count << " symbols\n" <<
+        "  multimap + match_peek  " << old_time << "s\n" <<
+        "  symbol_id              " << new_time << "s\n";
+    if (total_old != total_new)
+        std::cout << "  (the scanners disagree)\n";
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+    int errors = check_keywords() + check_symbols();
+    if (errors)
+    {
+        std::cerr << errors << " error(s)\n";
+        return 1;
+    }
+    std::cout << "keyword and symbol tables: ok\n";
+
+    if (argc >= 2 && std::string(argv[1]) == "--check")
+        return 0;
+
+    size_t repeat = (argc >= 2 ? strtoul(argv[1], NULL, 0) : 20000);
+    bench_symbols(repeat ? repeat : 20000);
+    return 0;
+}
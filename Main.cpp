@@ -1,14 +1,27 @@
 // Main.hpp --- darkload main
 // Copyright (C) 2017 Katayama Hirofumi MZ. License: MIT License
 #include "CParser.hpp"
+#include "FlatAST.hpp"
+#include "MappedFile.hpp"
 #include <iostream>
-#include <fstream>
+#include <cstdlib>
 
 void show_help(void)
 {
     std::cout <<
         "darkload --- C parser by katahiromz\n"
-        "Usage: darkload input_file.i" << std::endl;
+        "Usage: darkload [options] input_file.i\n"
+        "Options:\n"
+        "  --skim       skip the function bodies\n"
+        "  --recover    go on after a bad declaration\n"
+        "  --jobs N     parse the external declarations on N threads\n"
+        "  --compact    keep the expressions in the compact form\n"
+        "  --no-memo    parse without the packrat memo\n"
+        "  --memo-stats print the counters of the memo\n"
+        "  --flat       convert the A.S.T. to the flat form\n"
+        "  --profile-parser[=json]\n"
+        "               print the counters of the parser rules\n"
+        "               (needs a build with -DPROFILE_PARSER=ON)" << std::endl;
 }
 
 void show_version(void)
@@ -16,10 +29,34 @@ void show_version(void)
     std::cout << "darkload 0.0 by katahiromz\n";
 }
 
-int do_parse(const std::string& str)
+struct Options
+{
+    bool        skim;
+    bool        recover;
+    size_t      jobs;
+    bool        compact;
+    bool        flat;
+    bool        memo;
+    bool        memo_stats;
+    std::string profile;
+
+    Options() : skim(false), recover(false), jobs(1), compact(false),
+                flat(false), memo(true), memo_stats(false)
+    {
+    }
+};
+
+void print_memo_stats(const CodeReverse::MemoStats& stats)
+{
+    std::cerr << "memo: " << stats.m_lookups << " lookups, " <<
+                 stats.m_hits << " hits, " <<
+                 stats.m_tokens_saved << " tokens saved, " <<
+                 stats.m_evictions << " evictions\n";
+}
+
+int do_parse(CodeReverse::TextScanner& text, const Options& opts)
 {
     using namespace CodeReverse;
-    TextScanner text(str);
     AuxInfo aux;
 
     CodeReverse::Lexer lexer(text, aux);
@@ -30,11 +67,30 @@ int do_parse(const std::string& str)
         //std::cout << lexer;
 
         CParser parser(lexer);
+        parser.skim(opts.skim);
+        parser.recover(opts.recover);
+        parser.jobs(opts.jobs);
+        parser.compact(opts.compact);
+        parser.memoize(opts.memo);
         std::cerr << "parsing...\n";
-        if (parser.do_parse())
+        bool ok = parser.do_parse();
+        if (opts.profile == "table")
+            parser.profile().print_table(std::cout);
+        else if (opts.profile == "json")
+            parser.profile().print_json(std::cout);
+        if (opts.memo_stats)
+            print_memo_stats(parser.memo_stats());
+        if (ok)
         {
             if (auto ast = parser.ast())
             {
+                if (opts.flat)
+                {
+                    FlatAST flat_ast;
+                    flat_ast.from_tree(ast);
+                    std::cerr << "flat: " << flat_ast.size() << " nodes, " <<
+                                 flat_ast.bytes() << " bytes\n";
+                }
                 std::cerr << "done.\n";
                 return 0;
             }
@@ -54,9 +110,56 @@ int do_parse(const std::string& str)
 int just_do_it(int argc, char **argv)
 {
     const char *fname = NULL;
+    Options opts;
     for (int i = 1; i < argc; ++i)
     {
-        if (argv[i][0] == '-')
+        std::string arg = argv[i];
+        if (arg == "--skim")
+        {
+            opts.skim = true;
+        }
+        else if (arg == "--recover")
+        {
+            opts.recover = true;
+        }
+        else if (arg == "--compact")
+        {
+            opts.compact = true;
+        }
+        else if (arg == "--flat")
+        {
+            opts.flat = true;
+        }
+        else if (arg == "--no-memo")
+        {
+            opts.memo = false;
+        }
+        else if (arg == "--memo-stats")
+        {
+            opts.memo_stats = true;
+        }
+        else if (arg == "--profile-parser" || arg == "--profile-parser=json")
+        {
+#ifdef CR_PROFILE_PARSER
+            opts.profile = (arg == "--profile-parser" ? "table" : "json");
+#else
+            std::cerr << "error: " << arg << " needs a build with "
+                         "-DPROFILE_PARSER=ON\n";
+            return 2;
+#endif
+        }
+        else if (arg == "--jobs")
+        {
+            int count = (i + 1 < argc ? std::atoi(argv[i + 1]) : 0);
+            if (count <= 0)
+            {
+                std::cerr << "error: --jobs needs a positive number\n";
+                return 2;
+            }
+            opts.jobs = size_t(count);
+            ++i;
+        }
+        else if (arg[0] == '-')
         {
             std::cerr << "error: invalid argument '" << argv[i] << "'\n";
             return 2;
@@ -81,17 +184,15 @@ int just_do_it(int argc, char **argv)
         return 3;
     }
 
-    std::ifstream fs(fname);
-    if (!fs)
+    CodeReverse::MappedFile file;
+    if (!file.open(fname))
     {
         std::cerr << "error: cannot open input file '" << fname << "'\n";
         return 4;
     }
-    fs.unsetf(std::ios::skipws);
-    std::istreambuf_iterator<char> it = fs.rdbuf(), end;
-    std::string text(it, end);
 
-    return do_parse(text);
+    CodeReverse::TextScanner text(file.data(), file.size());
+    return do_parse(text, opts);
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,227 @@
+// MappedFile.hpp --- CodeReverse read-only memory-mapped file
+// Copyright (C) 2017 Katayama Hirofumi MZ. License: MIT License
+#ifndef CODEREVERSE_MAPPED_FILE_HPP
+#define CODEREVERSE_MAPPED_FILE_HPP
+
+#include "Common.hpp"
+#include <cstdio>       // for std::FILE, std::fopen, ...
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////
+
+namespace CodeReverse
+{
+    /////////////////////////////////////////////////////////////////////////
+    // MappedFile
+    //
+    // Maps the whole file read-only. The text is followed by a NUL, so it can
+    // be scanned in place by TextScanner(data(), size()). The OS zero-fills
+    // the rest of the last page; if the file fills its last page exactly,
+    // there is no room for the NUL and the file is read into a buffer instead.
+
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool open(const char *fname);
+        void close();
+
+        const char_type *data() const;
+        size_t size() const;
+        bool is_mapped() const;
+
+    protected:
+        const char_type *m_data;
+        size_t          m_size;
+        void *          m_view;
+        string_type     m_buffer;   // fallback storage
+#ifdef _WIN32
+        HANDLE          m_hFile;
+        HANDLE          m_hMapping;
+#endif
+
+        bool read_all(const char *fname);
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    // MappedFile inlines
+
+    inline MappedFile::MappedFile()
+        : m_data(""), m_size(0), m_view(NULL)
+#ifdef _WIN32
+        , m_hFile(INVALID_HANDLE_VALUE), m_hMapping(NULL)
+#endif
+    {
+    }
+    inline MappedFile::~MappedFile()
+    {
+        close();
+    }
+    inline const char_type *MappedFile::data() const
+    {
+        return m_data;
+    }
+    inline size_t MappedFile::size() const
+    {
+        return m_size;
+    }
+    inline bool MappedFile::is_mapped() const
+    {
+        return m_view != NULL;
+    }
+
+#ifdef _WIN32
+    inline bool MappedFile::open(const char *fname)
+    {
+        close();
+
+        m_hFile = ::CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (m_hFile == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER li;
+        if (!::GetFileSizeEx(m_hFile, &li) || size_t(li.QuadPart) != li.QuadPart)
+        {
+            close();
+            return false;
+        }
+
+        SYSTEM_INFO info;
+        ::GetSystemInfo(&info);
+        size_t size = size_t(li.QuadPart);
+        if (size == 0 || size % info.dwPageSize == 0)
+        {
+            ::CloseHandle(m_hFile);
+            m_hFile = INVALID_HANDLE_VALUE;
+            return read_all(fname);
+        }
+
+        m_hMapping = ::CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_hMapping)
+            m_view = ::MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (!m_view)
+        {
+            close();
+            return read_all(fname);
+        }
+
+        m_data = reinterpret_cast<const char_type *>(m_view);
+        m_size = size;
+        return true;
+    }
+    inline void MappedFile::close()
+    {
+        if (m_view)
+        {
+            ::UnmapViewOfFile(m_view);
+            m_view = NULL;
+        }
+        if (m_hMapping)
+        {
+            ::CloseHandle(m_hMapping);
+            m_hMapping = NULL;
+        }
+        if (m_hFile != INVALID_HANDLE_VALUE)
+        {
+            ::CloseHandle(m_hFile);
+            m_hFile = INVALID_HANDLE_VALUE;
+        }
+        m_buffer.clear();
+        m_data = "";
+        m_size = 0;
+    }
+#else   // ndef _WIN32
+    inline bool MappedFile::open(const char *fname)
+    {
+        close();
+
+        int fd = ::open(fname, O_RDONLY);
+        if (fd == -1)
+            return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        size_t size = size_t(st.st_size);
+        long page = ::sysconf(_SC_PAGESIZE);
+        if (size == 0 || page <= 0 || size % size_t(page) == 0)
+        {
+            ::close(fd);
+            return read_all(fname);
+        }
+
+        void *view = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return read_all(fname);
+
+        m_view = view;
+        m_data = reinterpret_cast<const char_type *>(view);
+        m_size = size;
+        return true;
+    }
+    inline void MappedFile::close()
+    {
+        if (m_view)
+        {
+            ::munmap(m_view, m_size);
+            m_view = NULL;
+        }
+        m_buffer.clear();
+        m_data = "";
+        m_size = 0;
+    }
+#endif  // ndef _WIN32
+
+    inline bool MappedFile::read_all(const char *fname)
+    {
+        std::FILE *fp = std::fopen(fname, "rb");
+        if (!fp)
+            return false;
+
+        char buf[64 * 1024];
+        size_t count;
+        while ((count = std::fread(buf, 1, sizeof(buf), fp)) > 0)
+        {
+            m_buffer.append(buf, count);
+        }
+        bool ok = !std::ferror(fp);
+        std::fclose(fp);
+        if (!ok)
+        {
+            m_buffer.clear();
+            return false;
+        }
+
+        m_data = m_buffer.c_str();
+        m_size = m_buffer.size();
+        return true;
+    }
+} // namespace CodeReverse
+
+/////////////////////////////////////////////////////////////////////////
+
+#endif  // ndef CODEREVERSE_MAPPED_FILE_HPP
@@ -0,0 +1,143 @@
+// ParserBench.cpp --- checks the parse on several threads and times it
+// Copyright (C) 2017 Katayama Hirofumi MZ. License: MIT License
+#include "CParser.hpp"
+#include "FlatAST.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+
+using namespace CodeReverse;
+
+/////////////////////////////////////////////////////////////////////////
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+struct ParseResult
+{
+    bool        m_ok;
+    size_t      m_chunks;       // CParser::chunks()
+    string_type m_errors;       // the output of AuxInfo::err_out()
+    FlatAST     m_flat;
+    double      m_seconds;      // of do_parse()
+};
+
+// parses the text on 'jobs' threads and keeps the tree in the flat form
+void parse(const string_type& str, size_t jobs, bool compact,
+           ParseResult& result)
+{
+    TextScanner text(str);
+    AuxInfo aux;
+    Lexer lexer(text, aux);
+    result.m_ok = lexer.do_lex();
+    result.m_chunks = 0;
+    result.m_flat.clear();
+    result.m_seconds = 0;
+    if (result.m_ok)
+    {
+        lexer.fixup();
+
+        CParser parser(lexer);
+        parser.jobs(jobs);
+        parser.compact(compact);
+        auto start = std::chrono::steady_clock::now();
+        result.m_ok = parser.do_parse();
+        result.m_seconds = seconds_since(start);
+        result.m_chunks = parser.chunks();
+        if (auto tu = parser.ast())
+            result.m_flat.from_tree(tu);
+    }
+
+    os_type os;
+    aux.err_out(os);
+    result.m_errors = os.str();
+}
+
+// the parse on several threads must give the same tree and the same
+// errors as the sequential one, and must not fall back to it if that
+// one succeeds
+bool check(const string_type& str, bool compact)
+{
+    ParseResult seq, par;
+    parse(str, 1, compact, seq);
+
+    static const size_t s_jobs[] = { 2, 3, 8 };
+    bool ok = true;
+    for (size_t i = 0; i < _countof(s_jobs); ++i)
+    {
+        parse(str, s_jobs[i], compact, par);
+        bool same = (par.m_ok == seq.m_ok && par.m_errors == seq.m_errors &&
+                     par.m_flat == seq.m_flat);
+        bool parallel = (par.m_chunks > 0 || !seq.m_ok);
+        std::cout << (compact ? "compact" : "plain") << ", " <<
+            s_jobs[i] << " jobs: " << par.m_chunks << " chunks, " <<
+            seq.m_flat.size() << " nodes: " <<
+            (same ? "same" : "DIFFERENT") <<
+            (parallel ? "" : " (not parsed in parallel)") << "\n";
+        ok = ok && same && parallel;
+    }
+    return ok;
+}
+
+// the best of 'repeat' parses of each
+void bench(const string_type& str, size_t jobs, size_t repeat)
+{
+    ParseResult seq, par;
+    double seq_time = 1e9, par_time = 1e9;
+    for (size_t k = 0; k < repeat; ++k)
+    {
+        parse(str, 1, false, seq);
+        seq_time = std::min(seq_time, seq.m_seconds);
+        parse(str, jobs, false, par);
+        par_time = std::min(par_time, par.m_seconds);
+    }
+    std::cout << seq.m_flat.size() << " nodes, " << par.m_chunks << " chunks\n" <<
+        "  sequential  " << seq_time * 1000 << " ms\n" <<
+        "  " << jobs << " jobs      " << par_time * 1000 << " ms  (best of " <<
+        repeat << ")\n";
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+    bool check_only = false;
+    const char *fname = NULL;
+    size_t jobs = 4;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--check")
+            check_only = true;
+        else if (!fname)
+            fname = argv[i];
+        else
+            jobs = strtoul(argv[i], NULL, 0);
+    }
+    if (!fname || jobs < 2)
+    {
+        std::cerr << "usage: parser_bench [--check] input.i [JOBS]\n";
+        return 2;
+    }
+
+    std::ifstream file(fname, std::ios::binary);
+    string_type str((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+    if (!file)
+    {
+        std::cerr << "cannot open '" << fname << "'\n";
+        return 2;
+    }
+
+    bool ok = check(str, false);
+    ok = check(str, true) && ok;
+    if (!ok)
+        return 1;
+    if (!check_only)
+        bench(str, jobs, 5);
+    return 0;
+}
@@ -5,6 +5,24 @@
 
 #include "Common.hpp"
 
+#ifndef CODEREVERSE_NO_SIMD
+    #if defined(__AVX2__)
+        #define CODEREVERSE_AVX2
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define CODEREVERSE_SSE2
+    #endif
+#endif
+#ifdef CODEREVERSE_AVX2
+    #include <immintrin.h>
+#elif defined(CODEREVERSE_SSE2)
+    #include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+    #include <intrin.h>     // for _BitScanForward
+#endif
+
 /////////////////////////////////////////////////////////////////////////
 
 namespace CodeReverse
@@ -42,7 +60,105 @@ namespace CodeReverse
     }
     inline bool is_space(char_type ch)
     {
-        return strchr(" \t\n\r\f\v", ch) && ch;
+        // ' ', '\t', '\n', '\v', '\f' or '\r'
+        return ch == ' ' || (unsigned char)(ch - '\t') <= '\r' - '\t';
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    // block scanning (AVX2 or SSE2 if the compiler targets it; the rest and
+    // the fallback are scalar)
+
+    inline unsigned int count_trailing_zeros(unsigned int mask)
+    {
+        assert(mask != 0);
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    // returns the first non-space in [p, end), or end
+    inline const char_type *scan_spaces(const char_type *p, const char_type *end)
+    {
+#ifdef CODEREVERSE_AVX2
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i four = _mm256_set1_epi8('\r' - '\t');
+        const __m256i zero = _mm256_setzero_si256();
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            __m256i ctrl = _mm256_subs_epu8(_mm256_sub_epi8(v, tab), four);
+            __m256i sp = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                         _mm256_cmpeq_epi8(ctrl, zero));
+            unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(sp);
+            if (mask)
+                return p + count_trailing_zeros(mask);
+        }
+#elif defined(CODEREVERSE_SSE2)
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i four = _mm_set1_epi8('\r' - '\t');
+        const __m128i zero = _mm_setzero_si128();
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+            __m128i ctrl = _mm_subs_epu8(_mm_sub_epi8(v, tab), four);
+            __m128i sp = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                      _mm_cmpeq_epi8(ctrl, zero));
+            unsigned int mask = ~(unsigned int)_mm_movemask_epi8(sp) & 0xFFFF;
+            if (mask)
+                return p + count_trailing_zeros(mask);
+        }
+#endif
+        while (p < end && is_space(*p))
+            ++p;
+        return p;
+    }
+
+    // returns the first c0 followed by c1 in [p, end), or end
+    inline const char_type *
+    scan_pair(const char_type *p, const char_type *end, char_type c0, char_type c1)
+    {
+#ifdef CODEREVERSE_AVX2
+        const __m256i v0 = _mm256_set1_epi8(c0);
+        const __m256i v1 = _mm256_set1_epi8(c1);
+        for (; end - p >= 33; p += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)p);
+            __m256i b = _mm256_loadu_si256((const __m256i *)(p + 1));
+            __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a, v0),
+                                          _mm256_cmpeq_epi8(b, v1));
+            unsigned int mask = (unsigned int)_mm256_movemask_epi8(eq);
+            if (mask)
+                return p + count_trailing_zeros(mask);
+        }
+#elif defined(CODEREVERSE_SSE2)
+        const __m128i v0 = _mm_set1_epi8(c0);
+        const __m128i v1 = _mm_set1_epi8(c1);
+        for (; end - p >= 17; p += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)p);
+            __m128i b = _mm_loadu_si128((const __m128i *)(p + 1));
+            __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(a, v0),
+                                       _mm_cmpeq_epi8(b, v1));
+            unsigned int mask = (unsigned int)_mm_movemask_epi8(eq);
+            if (mask)
+                return p + count_trailing_zeros(mask);
+        }
+#endif
+        for (; end - p >= 2; ++p)
+        {
+            p = (const char_type *)memchr(p, c0, end - p - 1);
+            if (!p)
+                break;
+            if (p[1] == c1)
+                return p;
+        }
+        return end;
     }
 
     /////////////////////////////////////////////////////////////////////////
@@ -51,7 +167,9 @@ namespace CodeReverse
     class TextScanner
     {
     public:
-        TextScanner(const string_type& str);
+        TextScanner(const string_type& str, bool scratch = false);
+        TextScanner(const char_type *text, size_t size);
+        ~TextScanner();
 
         char_type getch();
         void nextch();
@@ -59,6 +177,9 @@ namespace CodeReverse
         const char_type *peek() const;
         char_type peekch() const;
         void skip(size_t count);
+        void skip_spaces();
+        void skip_to(char_type ch);
+        bool skip_after(char_type c0, char_type c1);
 
         bool match_peek(const char_type *psz) const;
         bool match_peek(const char_type *psz, string_type& str) const;
@@ -67,79 +188,78 @@ namespace CodeReverse
         bool match_get(const char_type *psz, string_type& str);
 
         size_t index() const;
-        const string_type file() const;
+        const string_type& file() const;
+        void file(const char_type *fname, size_t len);
         size_t line() const;
+        void line(size_t line_);
         size_t column() const;
         Position pos() const;
         void pos(const Position& pos_);
 
+        const char_type *text() const;
+        size_t size() const;
+        unsigned int buffer() const;
+
     protected:
-        string_type     m_str;
+        string_type     m_str;      // owned copy (empty for a view)
+        const char_type *m_text;    // NUL-terminated
+        size_t          m_size;
         size_t          m_index;
-        Position        m_pos;
+        unsigned int    m_buffer;   // in FileTable; -1 for a scratch one
+        unsigned int    m_name;     // in FileTable
+        mutable unsigned int m_file;    // in FileTable; -1 to add by pos()
+        size_t          m_mark;     // the offset where m_mark_line is given
+        size_t          m_mark_line;
 
-        Position index2pos(size_t index) const;
+    private:
+        TextScanner(const TextScanner&);
+        TextScanner& operator=(const TextScanner&);
     };
 
     /////////////////////////////////////////////////////////////////////////
     // TextScanner inlines
 
-    inline TextScanner::TextScanner(const string_type& str)
-        : m_str(str), m_index(0)
+    // NOTE: A scratch scanner (e.g. for a directive) counts no lines. The
+    //       offset of its position is the column on the line of the mark.
+    inline TextScanner::TextScanner(const string_type& str, bool scratch)
+        : m_str(str), m_text(m_str.c_str()), m_size(m_str.size()), m_index(0),
+          m_buffer(-1), m_name(0), m_file(-1), m_mark(0), m_mark_line(0)
     {
+        if (!scratch)
+            m_buffer = FileTable::instance().add_buffer(m_text, m_size);
+    }
+    // NOTE: text[size] must be readable and zero. The text is not copied.
+    inline TextScanner::TextScanner(const char_type *text, size_t size)
+        : m_text(text), m_size(size), m_index(0),
+          m_name(0), m_file(-1), m_mark(0), m_mark_line(0)
+    {
+        assert(text[size] == 0);
+        m_buffer = FileTable::instance().add_buffer(m_text, m_size);
+    }
+    inline TextScanner::~TextScanner()
+    {
+        if (m_buffer != unsigned(-1))
+            FileTable::instance().release_buffer(m_buffer);
     }
     inline char_type TextScanner::getch()
     {
-        if (m_index < m_str.size())
-        {
-            if (m_str[m_index] == '\n')
-                m_pos.newline();
-            else
-                ++m_pos;
-            return m_str[m_index++];
-        }
+        if (m_index < m_size)
+            return m_text[m_index++];
         return 0;
     }
     inline void TextScanner::nextch()
     {
-        if (m_index < m_str.size())
-        {
-            if (m_str[m_index] == '\n')
-                m_pos.newline();
-            else
-                ++m_pos;
+        if (m_index < m_size)
             ++m_index;
-        }
     }
     inline void TextScanner::ungetch()
     {
         if (m_index > 0)
-        {
             --m_index;
-            if (m_str[m_index] == '\n')
-            {
-                size_t i, column = 0;
-                for (i = m_index; i > 0;)
-                {
-                    --i;
-                    if (m_str[i] == '\n')
-                        break;
-                    ++column;
-                }
-                m_pos.m_column = column;
-                assert(m_pos.m_line > 0);
-                --(m_pos.m_line);
-            }
-            else
-            {
-                assert(m_pos.m_column > 0);
-                --(m_pos.m_column);
-            }
-        }
     }
     inline const char_type *TextScanner::peek() const
     {
-        return &m_str.c_str()[m_index];
+        return &m_text[m_index];
     }
     inline char_type TextScanner::peekch() const
     {
@@ -148,7 +268,7 @@ namespace CodeReverse
     inline bool TextScanner::match_peek(const char_type *psz) const
     {
         const size_t len = strlen(psz);
-        if (memcmp(peek(), psz, len) == 0)
+        if (strncmp(peek(), psz, len) == 0)
         {
             assert(string_type(psz).find('\n') == string_type::npos);
             return true;
@@ -158,7 +278,7 @@ namespace CodeReverse
     inline bool TextScanner::match_peek(const char_type *psz, string_type& str) const
     {
         const size_t len = strlen(psz);
-        if (memcmp(peek(), psz, len) == 0)
+        if (strncmp(peek(), psz, len) == 0)
         {
             str = psz;
             assert(str.find('\n') == string_type::npos);
@@ -169,7 +289,7 @@ namespace CodeReverse
     inline bool TextScanner::match_get(const char_type *psz)
     {
         const size_t len = strlen(psz);
-        if (memcmp(peek(), psz, len) == 0)
+        if (strncmp(peek(), psz, len) == 0)
         {
             assert(string_type(psz).find('\n') == string_type::npos);
             skip(len);
@@ -180,7 +300,7 @@ namespace CodeReverse
     inline bool TextScanner::match_get(const char_type *psz, string_type& str)
     {
         const size_t len = strlen(psz);
-        if (memcmp(peek(), psz, len) == 0)
+        if (strncmp(peek(), psz, len) == 0)
         {
             str = psz;
             assert(str.find('\n') == string_type::npos);
@@ -191,53 +311,105 @@ namespace CodeReverse
     }
     inline void TextScanner::skip(size_t count)
     {
-        assert(m_str.substr(m_index, count).find('\n') == string_type::npos);
-        if (m_index + count <= m_str.size())
-        {
+        assert(string_type(peek(), m_index + count <= m_size ? count : m_size - m_index)
+               .find('\n') == string_type::npos);
+        if (m_index + count <= m_size)
             m_index += count;
-            m_pos += count;
-        }
         else
+            m_index = m_size;
+    }
+    // these may cross newlines
+    inline void TextScanner::skip_spaces()
+    {
+        m_index = scan_spaces(peek(), m_text + m_size) - m_text;
+    }
+    // skips to ch (or the end)
+    inline void TextScanner::skip_to(char_type ch)
+    {
+        const char_type *p = (const char_type *)memchr(peek(), ch, m_size - m_index);
+        m_index = (p ? p - m_text : m_size);
+    }
+    // skips past c0 followed by c1; returns false at the end
+    inline bool TextScanner::skip_after(char_type c0, char_type c1)
+    {
+        const char_type *p = scan_pair(peek(), m_text + m_size, c0, c1);
+        if (p == m_text + m_size)
         {
-            m_index = m_str.size();
-            m_pos = index2pos(m_index);
+            m_index = m_size;
+            return false;
         }
+        m_index = p + 2 - m_text;
+        return true;
     }
     inline size_t TextScanner::index() const
     {
         return m_index;
     }
-    inline const string_type TextScanner::file() const
+    inline const string_type& TextScanner::file() const
     {
-        return m_pos.file();
+        return FileTable::instance().name(pos().m_file);
     }
+    // the lines go on from the mark in the new file
+    inline void TextScanner::file(const char_type *fname, size_t len)
+    {
+        m_name = FileTable::instance().add_name(fname, len);
+        m_file = -1;
+    }
+    // the line and the column are looked up in the line index
     inline size_t TextScanner::line() const
     {
-        return m_pos.line();
+        if (m_buffer == unsigned(-1))
+            return m_mark_line;
+
+        FileTable& table = FileTable::instance();
+        return m_mark_line + (table.buffer_line(m_buffer, m_index) -
+                              table.buffer_line(m_buffer, m_mark));
+    }
+    // the line of the current position is line_
+    inline void TextScanner::line(size_t line_)
+    {
+        m_mark_line = line_;
+        m_mark = m_index;
+        m_file = -1;
     }
     inline size_t TextScanner::column() const
     {
-        return m_pos.column();
+        if (m_buffer == unsigned(-1))
+            return m_index;
+        return FileTable::instance().buffer_column(m_buffer, m_index);
     }
+    // the file begins at the mark after a change of the file or the line
     inline Position TextScanner::pos() const
     {
-        return m_pos;
+        if (m_file == unsigned(-1))
+        {
+            FileTable& table = FileTable::instance();
+            if (m_buffer == unsigned(-1))
+                m_file = table.add_file(m_name, m_mark_line);
+            else
+                m_file = table.add_file(m_name, m_mark_line, m_buffer, m_mark);
+        }
+        return Position(m_file, m_index);
     }
     inline void TextScanner::pos(const Position& pos_)
     {
-        m_pos = pos_;
+        m_mark_line = pos_.line();
+        m_mark = m_index;
+        m_name = FileTable::instance().name_id(pos_.m_file);
+        m_file = -1;
     }
-    inline Position TextScanner::index2pos(size_t index) const
+    inline const char_type *TextScanner::text() const
     {
-        Position pos;
-        for (size_t i = 0; i < index; ++i)
-        {
-            if (m_str[i] == '\n')
-                pos.newline();
-            else
-                ++pos;
-        }
-        return pos;
+        return m_text;
+    }
+    inline size_t TextScanner::size() const
+    {
+        return m_size;
+    }
+    // in FileTable; -1 for a scratch scanner
+    inline unsigned int TextScanner::buffer() const
+    {
+        return m_buffer;
     }
 } // namespace CodeReverse
 
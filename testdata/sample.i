@@ -0,0 +1,119 @@
+# 1 "sample.c"
+typedef unsigned int UINT;
+typedef unsigned long size_t;
+typedef struct tagPOINT { int x, y; } POINT, *PPOINT;
+typedef union tagVALUE { int i; double d; char *s; } VALUE;
+typedef int (*COMPARE)(const void *, const void *);
+enum COLOR { RED, GREEN = 5, BLUE = GREEN << 2, ALPHA };
+struct list { struct list *next; VALUE value; unsigned flags : 3; };
+extern int printf(const char *fmt, ...) __attribute__ ((__format__ (__printf__, 1, 2)));
+extern void *malloc(size_t size);
+extern void free(void *ptr);
+static const char *names[] = { "red", "green", [3] = "blue" };
+static POINT origin = { .x = 0, .y = 0 };
+int counts[2][3] = { { 1, 2, 3 }, { 4, 5, 6 } };
+_Static_assert(sizeof(int) >= 2, "int is too small");
+_Alignas(16) static char buffer[64];
+_Noreturn void die(int code);
+static inline int square(int n) { return n * n; }
+# 20 "sample.c"
+int compare_ints(const void *a, const void *b)
+{
+    const int *x = (const int *)a, *y = (const int *)b;
+    return (*x > *y) - (*x < *y);
+}
+# 26 "sample.c"
+UINT sum(const UINT *array, size_t count)
+{
+    UINT total = 0;
+    size_t i;
+    for (i = 0; i < count; ++i)
+        total += array[i];
+    return total;
+}
+# 35 "sample.c"
+struct list *push(struct list *head, int i)
+{
+    struct list *node = (struct list *)malloc(sizeof(*node));
+    if (!node)
+        return head;
+    node->next = head;
+    node->value.i = i;
+    node->flags = i & 7;
+    return node;
+}
+# 46 "sample.c"
+int classify(enum COLOR color, POINT pt)
+{
+    typedef int LOCAL;
+    LOCAL result = 0;
+    switch (color)
+    {
+    case RED:
+        result = pt.x > 0 ? 1 : -1;
+        break;
+    case GREEN:
+    case BLUE:
+        result = (pt.x + pt.y) % 3;
+        break;
+    default:
+        result = ALPHA;
+    }
+    while (result > 10)
+    {
+        if (result & 1)
+            continue;
+        result >>= 1;
+    }
+    do
+    {
+        result--;
+    } while (result > 0 && !(result == 5 || result == 7));
+    if (result < -100)
+        goto out;
+    result = _Generic(result, int: 1, default: 0);
+out:
+    return result;
+}
+# 79 "sample.c"
+double average(int count, ...)
+{
+    __builtin_va_list va;
+    double total = 0.0;
+    int k;
+    for (k = 0; k < count; k++)
+    {
+        total += (double)k * 1.5e-3 + 'a' - L'b';
+    }
+    return count ? total / count : 0.0;
+}
+# 91 "sample.c"
+void free_list(struct list *head)
+{
+    struct list *next;
+    for (; head; head = next)
+    {
+        next = head->next;
+        free(head);
+    }
+}
+# 99 "sample.c"
+void fill(int (*)[2][3], int [3][4][5], int (*)(void));
+# 101 "sample.c"
+int main(int argc, char **argv)
+{
+    PPOINT p = &origin;
+    POINT pts[4] = { { 1, 2 }, { 3, 4 } };
+    struct list *head = 0;
+    COMPARE cmp = compare_ints;
+    int i, n = argc > 1 ? argc : 4;
+    unsigned long mask = ~0UL ^ (1UL << 3);
+    for (i = 0; i < n; i++)
+        head = push(head, i * i);
+    p->x = pts[1].y, p->y = -pts[0].x;
+    printf("%s %d %lu\n", names[i % 2], classify(GREEN, *p), mask);
+    printf("%d %d\n", cmp(&i, &n), square(sizeof(POINT) / sizeof(int)));
+    n = sizeof(int[3][4]) + sizeof(int (*)[2][3]) + sizeof(char (*(*)(void))[2]);
+    free_list(head);
+    return (int)sum((const UINT *)counts, 6) != 21;
+}